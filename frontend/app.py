@@ -18,6 +18,7 @@ if 'logged_in' not in st.session_state:
     st.session_state.logged_in = False
     st.session_state.username = ""
     st.session_state.user_id = None
+    st.session_state.token = None
 
 # --- API Client Functions ---
 def api_login(username, password):
@@ -36,10 +37,19 @@ def api_signin(username, password, email):
     except Exception as e:
         return {"success": False, "message": str(e)}
 
+def api_logout():
+    try:
+        requests.post(f"{API_BASE_URL}/logout", headers=auth_headers())
+    except requests.exceptions.ConnectionError:
+        pass
+
+def auth_headers():
+    return {"Authorization": f"Bearer {st.session_state.token}"}
+
 
 def api_get_portfolio(user_id):
     try:
-        response = requests.get(f"{API_BASE_URL}/portfolio/{user_id}")
+        response = requests.get(f"{API_BASE_URL}/portfolio/{user_id}", headers=auth_headers())
         if response.status_code == 200:
             data = response.json()
             balance = data.get('fundBalance', 0.0)
@@ -58,7 +68,7 @@ def api_execute_transaction(user_id, symbol, quantity, price, trans_type):
         "type": trans_type
     }
     try:
-        response = requests.post(f"{API_BASE_URL}/transaction", json=payload)
+        response = requests.post(f"{API_BASE_URL}/transaction", json=payload, headers=auth_headers())
         if response.status_code == 200:
             return response.json()
     except requests.exceptions.ConnectionError:
@@ -104,6 +114,7 @@ def show_login():
                         st.session_state.logged_in = True
                         st.session_state.username = result.get("username")
                         st.session_state.user_id = result.get("userId")
+                        st.session_state.token = result.get("token")
                         st.rerun() # Use modern rerun
                     else:
                         st.error(result.get("message", "Invalid username or password"))
@@ -126,6 +137,7 @@ def show_login():
                         st.session_state.logged_in = True
                         st.session_state.username = result.get("username")
                         st.session_state.user_id = result.get("userId")
+                        st.session_state.token = result.get("token")
                         st.rerun() # Use modern rerun
                     else:
                         st.error(result.get("message", "Sign up failed. Username or email may already be in use."))
@@ -143,7 +155,9 @@ def main_app():
     pages[selection]()
     
     if st.sidebar.button("Logout"):
+        api_logout()
         st.session_state.logged_in = False
+        st.session_state.token = None
         st.rerun()
 
 def page_portfolio():
@@ -192,7 +206,7 @@ def page_stock_info():
         with st.spinner("Requesting backend to fetch data..."):
             result = api_update_stocks()
             if result.get("success"):
-                st.success("Backend successfully updated the stock database!")
+                st.success(f"Stock database update queued (job {result.get('jobId')}).")
             else:
                 st.error(f"Error: {result.get('message')}")
     
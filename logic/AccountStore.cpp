@@ -0,0 +1,389 @@
+#include "AccountStore.h"
+#include "Logger.h"
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+constexpr size_t PROJECT_BATCH = 4096;
+constexpr size_t ANSWER_BATCH = 256; // most requests a shard runs before it flushes and answers them
+constexpr auto PROJECT_INTERVAL = std::chrono::milliseconds(5);
+constexpr auto RETRY_INTERVAL = std::chrono::milliseconds(500);
+
+JournalRecord toRecord(int user_id, const Trade& trade) {
+    JournalRecord record;
+    record.user_id = user_id;
+    record.sell = trade.type == "sell";
+    record.quantity = trade.quantity;
+    record.price_micros = trade.price.getMicros();
+    record.symbol = SymbolTable::global().name(trade.symbol);
+    return record;
+}
+
+} // namespace
+
+AccountStore::AccountStore(const std::vector<TradeJournal*>& journals, Loader loader, Projector projector)
+    : loader(std::move(loader)), projector(std::move(projector)) {
+    shards.reserve(journals.size());
+    for (TradeJournal* journal : journals) {
+        shards.push_back(std::make_unique<Shard>());
+        Shard& shard = *shards.back();
+        shard.journal = journal;
+        shard.thread = std::thread([this, &shard]() { serve(shard); });
+    }
+}
+
+AccountStore::~AccountStore() {
+    for (auto& shard : shards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            shard->stopping = true;
+        }
+        shard->cv.notify_one();
+    }
+    for (auto& shard : shards) {
+        shard->thread.join();
+    }
+
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+bool AccountStore::start(const std::vector<uint64_t>& projected) {
+    uint64_t replaying = 0;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        TradeJournal& journal = *shards[i]->journal;
+        uint64_t first = journal.firstSeq();
+        uint64_t next = journal.nextSeq();
+        if (next < projected[i] + 1) {
+            // The journal ends before the database does (it was lost or
+            // replaced); start a fresh one numbered after it so new records
+            // are never mistaken for old.
+            if (!journal.reset(projected[i] + 1)) {
+                Logger::error("Failed to reset trade journal {}: {}", i, journal.error());
+                return false;
+            }
+        } else if (first > projected[i] + 1) {
+            Logger::error("Trade journal {} starts at {} but the database stops at {}; records in between are missing.",
+                          i, first, projected[i]);
+            return false;
+        } else {
+            replaying += next - projected[i] - 1;
+        }
+        shards[i]->projected = projected[i];
+    }
+
+    if (replaying > 0) {
+        Logger::info("Replaying {} journaled trades", replaying);
+    }
+    while (!projectedAll()) {
+        if (!project()) {
+            Logger::error("Failed to replay trade journal.");
+            return false;
+        }
+    }
+
+    worker = std::thread(&AccountStore::run, this);
+    return true;
+}
+
+void AccountStore::Inbox::push(Task* task) {
+    task->next.store(nullptr, std::memory_order_relaxed);
+    Task* prev = tail.exchange(task);
+    prev->next.store(task);
+}
+
+AccountStore::Task* AccountStore::Inbox::pop() {
+    Task* first = head;
+    Task* next = first->next.load();
+    if (first == &stub) {
+        if (next == nullptr) return nullptr;
+        head = next;
+        first = next;
+        next = next->next.load();
+    }
+    if (next != nullptr) {
+        head = next;
+        return first;
+    }
+    if (first != tail.load()) return nullptr; // a producer is between its two steps
+    // first is the only task left; put the stub behind it so it can be unlinked.
+    push(&stub);
+    next = first->next.load();
+    if (next == nullptr) return nullptr;
+    head = next;
+    return first;
+}
+
+void AccountStore::post(Shard& shard, Task& task) {
+    shard.inbox.push(&task);
+    // Pairs with serve(), which sets sleeping before its last look at the inbox.
+    if (shard.sleeping.load()) {
+        { std::lock_guard<std::mutex> lock(shard.mtx); }
+        shard.cv.notify_one();
+    }
+}
+
+void AccountStore::wait(Task& task) {
+    std::unique_lock<std::mutex> lock(task.mtx);
+    task.cv.wait(lock, [&]() { return task.done; });
+}
+
+template <typename F>
+void AccountStore::call(Shard& shard, F&& work) {
+    using Work = std::remove_reference_t<F>;
+    Task task;
+    task.invoke = [](void* context, Shard& on) { (*static_cast<Work*>(context))(on); };
+    task.context = &work;
+    post(shard, task);
+    wait(task);
+}
+
+void AccountStore::serve(Shard& shard) {
+    std::vector<Task*> ran;
+    while (true) {
+        Task* task = shard.inbox.pop();
+        if (task == nullptr && !ran.empty()) {
+            answer(shard, ran);
+            continue;
+        }
+        if (task == nullptr) {
+            std::unique_lock<std::mutex> lock(shard.mtx);
+            shard.sleeping.store(true);
+            shard.cv.wait(lock, [&]() { return (task = shard.inbox.pop()) != nullptr || shard.stopping; });
+            shard.sleeping.store(false, std::memory_order_relaxed);
+            if (task == nullptr) return;
+        }
+        task->invoke(task->context, shard);
+        ran.push_back(task);
+        if (ran.size() >= ANSWER_BATCH) answer(shard, ran);
+    }
+}
+
+void AccountStore::answer(Shard& shard, std::vector<Task*>& ran) {
+    // One flush covers every trade the batch journaled, so none is
+    // acknowledged before it would survive a power loss. If the flush fails
+    // the trades stay applied; the projector keeps retrying it.
+    if (shard.unflushed) {
+        shard.unflushed = false;
+        if (!shard.journal->flush()) {
+            Logger::error("Failed to flush trade journal: {}", shard.journal->error());
+        }
+    }
+    for (Task* task : ran) {
+        // Notified under the lock: the poster may destroy the task as soon as it sees done.
+        std::lock_guard<std::mutex> lock(task->mtx);
+        task->done = true;
+        task->cv.notify_one();
+    }
+    ran.clear();
+}
+
+Portfolio* AccountStore::account(Shard& shard, int user_id) {
+    auto it = shard.accounts.find(user_id);
+    if (it != shard.accounts.end()) return &it->second;
+
+    Portfolio portfolio;
+    if (!loader(user_id, portfolio)) return nullptr;
+    portfolio.clearPendingTrades();
+    return &shard.accounts.emplace(user_id, std::move(portfolio)).first->second;
+}
+
+bool AccountStore::load(int user_id, Portfolio& portfolio) {
+    bool found = false;
+    call(shardFor(user_id), [&](Shard& shard) {
+        Portfolio* current = account(shard, user_id);
+        if (current == nullptr) return;
+        portfolio = *current;
+        found = true;
+    });
+    return found;
+}
+
+bool AccountStore::commit(int user_id, const std::vector<Trade>& trades) {
+    if (trades.empty()) return true;
+
+    TradeResult result = TradeResult::Failed;
+    call(shardFor(user_id), [&](Shard& shard) { result = apply(shard, user_id, trades); });
+    return result == TradeResult::Applied;
+}
+
+TradeResult AccountStore::execute(int user_id, const Trade& trade) {
+    std::vector<Trade> trades(1, trade);
+    TradeResult result = TradeResult::Failed;
+    call(shardFor(user_id), [&](Shard& shard) { result = apply(shard, user_id, trades); });
+    return result;
+}
+
+TradeResult AccountStore::apply(Shard& shard, int user_id, const std::vector<Trade>& trades) {
+    Portfolio* current = account(shard, user_id);
+    if (current == nullptr) return TradeResult::Failed;
+
+    // Check the whole batch against the live account before writing any of it.
+    Money cash = current->getFundBalance();
+    std::vector<std::pair<SymbolId, int>> net_shares; // running change per symbol
+    for (const Trade& trade : trades) {
+        if (trade.quantity <= 0 || trade.price <= Money()) {
+            Logger::error("Trade quantity and price must be positive.");
+            return TradeResult::Rejected;
+        }
+        int net = 0;
+        for (const auto& entry : net_shares) {
+            if (entry.first == trade.symbol) net = entry.second;
+        }
+        int held = current->getHeldQuantity(trade.symbol) + net;
+        int change = trade.type == "buy" ? trade.quantity : -trade.quantity;
+        Money amount;
+        if (!Money::multiply(trade.price, trade.quantity, amount)) {
+            Logger::error("Trade amount out of range.");
+            return TradeResult::Rejected;
+        }
+        if (trade.type == "buy") {
+            if (cash < amount) {
+                Logger::error("Insufficient funds.");
+                return TradeResult::Rejected;
+            }
+            cash -= amount;
+        } else {
+            if (held < trade.quantity) {
+                Logger::error("Not enough shares to sell.");
+                return TradeResult::Rejected;
+            }
+            if (!Money::add(cash, amount, cash)) {
+                Logger::error("Trade amount out of range.");
+                return TradeResult::Rejected;
+            }
+        }
+        net_shares.push_back({trade.symbol, net + change});
+    }
+
+    std::vector<JournalRecord> records;
+    records.reserve(trades.size());
+    for (const Trade& trade : trades) records.push_back(toRecord(user_id, trade));
+    if (!shard.journal->append(records)) {
+        Logger::error("Failed to journal trades: {}", shard.journal->error());
+        return TradeResult::Failed;
+    }
+    shard.unflushed = true;
+
+    // Every amount was checked above, so none of these can be refused.
+    for (const Trade& trade : trades) current->applyTrade(trade);
+    return TradeResult::Applied;
+}
+
+bool AccountStore::settle(const std::vector<Fill>& fills, std::vector<Fill>& refused, std::vector<Fill>& failed) {
+    // Each shard settles its own accounts' fills, in order, alongside the others.
+    struct Batch {
+        AccountStore* store;
+        std::vector<const Fill*> fills;
+        std::vector<Fill> refused;
+        std::vector<Fill> failed;
+        Task task;
+    };
+    std::vector<std::unique_ptr<Batch>> batches(shards.size());
+    for (const Fill& fill : fills) {
+        auto& batch = batches[static_cast<uint32_t>(fill.user_id) % shards.size()];
+        if (!batch) {
+            batch = std::make_unique<Batch>();
+            batch->store = this;
+        }
+        batch->fills.push_back(&fill);
+    }
+
+    for (size_t i = 0; i < batches.size(); ++i) {
+        if (!batches[i]) continue;
+        Batch& batch = *batches[i];
+        batch.task.context = &batch;
+        batch.task.invoke = [](void* context, Shard& shard) {
+            Batch& batch = *static_cast<Batch*>(context);
+            std::vector<JournalRecord> records(1);
+            for (const Fill* fill : batch.fills) {
+                Trade trade{fill->symbol, fill->side == Side::Buy ? "buy" : "sell", fill->quantity, fill->price};
+                records[0] = toRecord(fill->user_id, trade);
+                records[0].order_id = fill->order_id;
+                records[0].remaining = fill->remaining;
+
+                Portfolio* current = batch.store->account(shard, fill->user_id);
+                if (current != nullptr && !current->covers(trade)) {
+                    batch.refused.push_back(*fill);
+                    continue;
+                }
+                if (current == nullptr || !shard.journal->append(records)) {
+                    Logger::error("Failed to journal fill for order {}: {}", fill->order_id, shard.journal->error());
+                    batch.failed.push_back(*fill);
+                    continue;
+                }
+                shard.unflushed = true;
+                current->applyTrade(trade); // covers() ruled out an amount it would refuse
+            }
+        };
+        post(*shards[i], batch.task);
+    }
+
+    bool ok = true;
+    for (auto& batch : batches) {
+        if (!batch) continue;
+        wait(batch->task);
+        ok = ok && batch->failed.empty();
+        refused.insert(refused.end(), batch->refused.begin(), batch->refused.end());
+        failed.insert(failed.end(), batch->failed.begin(), batch->failed.end());
+    }
+    return ok;
+}
+
+bool AccountStore::project() {
+    std::vector<std::vector<JournalRecord>> batches(shards.size());
+    bool any = false;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        Shard& shard = *shards[i];
+        // The database must never get ahead of what is durable in the journal.
+        if (!shard.journal->flush()) {
+            Logger::error("Failed to flush trade journal {}: {}", i, shard.journal->error());
+            return false;
+        }
+        shard.journal->read(shard.projected + 1, PROJECT_BATCH, batches[i]);
+        any = any || !batches[i].empty();
+    }
+    if (!any) return true;
+    if (!projector(batches)) return false;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!batches[i].empty()) shards[i]->projected = batches[i].back().seq;
+    }
+    return true;
+}
+
+bool AccountStore::projectedAll() {
+    for (const auto& shard : shards) {
+        if (shard->projected + 1 < shard->journal->nextSeq()) return false;
+    }
+    return true;
+}
+
+void AccountStore::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        bool stop = stopping;
+        lock.unlock();
+
+        bool ok = project();
+        bool idle = ok && projectedAll();
+        if (!ok) {
+            Logger::error("Failed to project trade journal; retrying.");
+        }
+
+        lock.lock();
+        if (stop && (idle || !ok)) break;
+        if (idle) {
+            cv.wait_for(lock, PROJECT_INTERVAL);
+        } else if (!ok) {
+            cv.wait_for(lock, RETRY_INTERVAL);
+        }
+    }
+}
@@ -0,0 +1,162 @@
+#ifndef ACCOUNTSTORE_H
+#define ACCOUNTSTORE_H
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "Portfolio.h"
+#include "OrderBook.h"
+#include "TradeJournal.h"
+
+/**
+ * @class AccountStore
+ * @brief Authoritative in-memory account state backed by TradeJournals.
+ *
+ * Accounts are partitioned by user id across shard threads. Each shard owns
+ * its accounts and its journal outright and works through a lock-free inbox
+ * of requests posted by any thread, one at a time, so every account sees its
+ * trades strictly in order and no two shards ever contend for a lock. A
+ * trade is checked against the account, appended to the shard's journal and
+ * applied; nothing waits on SQLite. Callers block until their request has
+ * run and is on disk: a shard drains its inbox, flushes its journal once for
+ * everything it ran, and only then answers, so concurrent trades share one
+ * fsync.
+ *
+ * A background thread wakes every few milliseconds and projects every
+ * journal into the database in order, handing the projector one batch per
+ * journal, so the projection can checkpoint each journal in the same
+ * transaction. An account's trades all live in one journal, so the order
+ * between journals does not matter.
+ *
+ * Accounts are loaded from the database the first time they are touched.
+ * That is safe because the projection is caught up before start() returns,
+ * and from then on an account is only written through this store.
+ */
+class AccountStore {
+public:
+    // Reads an account from the database. Returns false on a database error.
+    using Loader = std::function<bool(int user_id, Portfolio& portfolio)>;
+    // Applies journal records to the database; batches[i] holds the next
+    // records of journal i, possibly none. Returns false to retry later.
+    using Projector = std::function<bool(const std::vector<std::vector<JournalRecord>>& batches)>;
+
+    /**
+     * @param journals One per shard thread; shard i appends to journals[i].
+     */
+    AccountStore(const std::vector<TradeJournal*>& journals, Loader loader, Projector projector);
+
+    /**
+     * @brief Stops the shards, projects whatever is left in the journals, then
+     *        stops the projector.
+     */
+    ~AccountStore();
+
+    AccountStore(const AccountStore&) = delete;
+    AccountStore& operator=(const AccountStore&) = delete;
+
+    /**
+     * @brief Replays journal records not yet in the database and starts the
+     *        background projector.
+     * @param projected Last sequence number of each journal already in the database.
+     * @return false if a journal does not reach back to its projected
+     *         sequence number + 1 or the replay fails.
+     */
+    bool start(const std::vector<uint64_t>& projected);
+
+    /**
+     * @brief Copies the current state of an account into @p portfolio.
+     */
+    bool load(int user_id, Portfolio& portfolio);
+
+    /**
+     * @brief Journals and applies trades as one unit.
+     * @return false, with nothing applied, if any trade lacks funds or shares
+     *         or the journal cannot be written.
+     */
+    bool commit(int user_id, const std::vector<Trade>& trades);
+
+    /**
+     * @brief Checks, journals and applies one trade as a single step on the
+     *        account's shard.
+     */
+    TradeResult execute(int user_id, const Trade& trade);
+
+    /**
+     * @brief Journals and applies matching-engine fills. A fill whose account
+     *        no longer has the cash or shares for it (they were spent after
+     *        the order was placed) is not applied but added to @p refused.
+     *        Fills that could not be journaled are added to @p failed.
+     * @return false if any fill failed.
+     */
+    bool settle(const std::vector<Fill>& fills, std::vector<Fill>& refused, std::vector<Fill>& failed);
+
+private:
+    struct Shard;
+
+    // A request waiting in a shard's inbox. It lives on the stack of the
+    // thread that posted it, which waits for done before returning.
+    struct Task {
+        std::atomic<Task*> next{nullptr};
+        void (*invoke)(void* context, Shard& shard) = nullptr;
+        void* context = nullptr;
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool done = false;
+    };
+
+    // Intrusive multi-producer, single-consumer queue (Vyukov's): posting is
+    // one atomic exchange, and only the shard thread pops.
+    class Inbox {
+    public:
+        Inbox() : head(&stub), tail(&stub) {}
+        void push(Task* task);
+        Task* pop(); // nullptr if empty or a push is half done
+    private:
+        Task stub;
+        Task* head;              // shard thread only
+        std::atomic<Task*> tail; // last pushed
+    };
+
+    struct Shard {
+        Inbox inbox;
+        std::atomic<bool> sleeping{false};
+        std::mutex mtx; // only to park and wake the shard thread
+        std::condition_variable cv;
+        bool stopping = false;
+        bool unflushed = false; // journaled since the last flush; shard thread only
+        std::unordered_map<int, Portfolio> accounts; // shard thread only
+        TradeJournal* journal = nullptr;
+        uint64_t projected = 0; // last record in the database; projector thread only
+        std::thread thread;
+    };
+
+    Shard& shardFor(int user_id) { return *shards[static_cast<uint32_t>(user_id) % shards.size()]; }
+    void post(Shard& shard, Task& task);
+    static void wait(Task& task);
+    template <typename F> void call(Shard& shard, F&& work);
+    void serve(Shard& shard);
+    void answer(Shard& shard, std::vector<Task*>& ran);
+
+    Portfolio* account(Shard& shard, int user_id); // on the shard's thread
+    TradeResult apply(Shard& shard, int user_id, const std::vector<Trade>& trades);
+    bool project();
+    bool projectedAll();
+    void run();
+
+    Loader loader;
+    Projector projector;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif // ACCOUNTSTORE_H
@@ -0,0 +1,165 @@
+#include "ConnectionPool.h"
+#include "Logger.h"
+#include "sqlite3.h"
+#include <utility>
+#include <algorithm>
+
+namespace {
+
+// Pool ids are never reused, so a stale thread-local entry left behind by a
+// destroyed pool can never be mistaken for a live one.
+std::atomic<uint64_t> next_pool_id{1};
+
+// The calling thread's connections, one per pool. A thread normally talks to
+// a single pool, so a linear scan is cheaper than any locked lookup. On
+// thread exit each connection is handed back to its pool, if it still exists.
+struct ThreadConnections {
+    struct Entry {
+        uint64_t pool_id;
+        Connection* conn;
+        std::weak_ptr<ConnectionPool::Connections> pool;
+    };
+    std::vector<Entry> entries;
+
+    ~ThreadConnections() {
+        for (Entry& entry : entries) {
+            if (auto pool = entry.pool.lock()) pool->release(entry.conn);
+        }
+    }
+};
+thread_local ThreadConnections thread_connections;
+
+const char* CONNECTION_PRAGMAS = R"SQL(
+    PRAGMA journal_mode = WAL;
+    PRAGMA synchronous = NORMAL;
+    PRAGMA cache_size = -16384;
+    PRAGMA mmap_size = 268435456;
+)SQL";
+
+} // namespace
+
+Statement::~Statement() {
+    if (stmt != nullptr) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+Connection::~Connection() {
+    for (auto& entry : statements) {
+        sqlite3_finalize(entry.second);
+    }
+    sqlite3_close(db);
+}
+
+sqlite3_stmt* Connection::prepare(const char* sql) {
+    auto it = statements.find(std::string_view(sql));
+    if (it != statements.end()) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        Logger::error("Failed to prepare statement: {}", sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    sql_texts.push_back(std::make_unique<const std::string>(sql));
+    statements.emplace(std::string_view(*sql_texts.back()), stmt);
+    return stmt;
+}
+
+StatementCacheStats Connection::stats() const {
+    StatementCacheStats s;
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    return s;
+}
+
+void ConnectionPool::Connections::release(Connection* conn) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (closed) return;
+    if (idle.size() < MAX_IDLE_CONNECTIONS) {
+        idle.push_back(conn);
+        return;
+    }
+    auto it = std::find_if(open.begin(), open.end(), [conn](const auto& owned) { return owned.get() == conn; });
+    if (it == open.end()) return;
+    StatementCacheStats s = conn->stats();
+    retired.hits += s.hits;
+    retired.misses += s.misses;
+    open.erase(it);
+}
+
+ConnectionPool::ConnectionPool(const std::string& db_path)
+    : db_file(db_path), pool_id(next_pool_id.fetch_add(1)), connections(std::make_shared<Connections>()) {}
+
+ConnectionPool::~ConnectionPool() {
+    std::lock_guard<std::mutex> lock(connections->mtx);
+    connections->closed = true;
+    connections->idle.clear();
+    connections->open.clear();
+}
+
+Connection* ConnectionPool::acquire() {
+    for (const auto& entry : thread_connections.entries) {
+        if (entry.pool_id == pool_id) return entry.conn;
+    }
+
+    Connection* raw = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(connections->mtx);
+        if (!connections->idle.empty()) {
+            raw = connections->idle.back();
+            connections->idle.pop_back();
+        }
+    }
+    if (raw == nullptr) {
+        sqlite3* db;
+        {
+            std::lock_guard<std::mutex> lock(open_mtx);
+            db = open();
+        }
+        if (db == nullptr) return nullptr;
+
+        auto conn = std::make_unique<Connection>(db);
+        raw = conn.get();
+        std::lock_guard<std::mutex> lock(connections->mtx);
+        connections->open.push_back(std::move(conn));
+    }
+    thread_connections.entries.push_back({pool_id, raw, connections});
+    return raw;
+}
+
+StatementCacheStats ConnectionPool::statementCacheStats() {
+    std::lock_guard<std::mutex> lock(connections->mtx);
+    StatementCacheStats total = connections->retired;
+    for (const auto& conn : connections->open) {
+        StatementCacheStats s = conn->stats();
+        total.hits += s.hits;
+        total.misses += s.misses;
+    }
+    return total;
+}
+
+sqlite3* ConnectionPool::open() {
+    sqlite3* db = nullptr;
+    // Each connection is only ever used by the thread that opened it.
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(db_file.c_str(), &db, flags, nullptr) != SQLITE_OK) {
+        Logger::error("Can't open database: {}", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    sqlite3_busy_timeout(db, 5000);
+
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, CONNECTION_PRAGMAS, 0, 0, &errMsg) != SQLITE_OK) {
+        Logger::warn("Failed to apply connection pragmas: {}", errMsg);
+        sqlite3_free(errMsg);
+    }
+    return db;
+}
@@ -0,0 +1,148 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/**
+ * @struct StatementCacheStats
+ * @brief Prepared-statement cache counters, summed over every pooled connection.
+ */
+struct StatementCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+/**
+ * @class Statement
+ * @brief Scoped borrow of a cached prepared statement.
+ *
+ * On destruction the statement is reset and its bindings cleared so the next
+ * caller finds it ready to bind again. The statement itself stays cached.
+ */
+class Statement {
+public:
+    explicit Statement(sqlite3_stmt* stmt) : stmt(stmt) {}
+    ~Statement();
+
+    Statement(const Statement&) = delete;
+    Statement& operator=(const Statement&) = delete;
+
+    sqlite3_stmt* get() const { return stmt; }
+    explicit operator bool() const { return stmt != nullptr; }
+
+private:
+    sqlite3_stmt* stmt;
+};
+
+/**
+ * @class Connection
+ * @brief A single SQLite connection plus its cache of prepared statements.
+ *
+ * A connection is used by one thread at a time (a pooled connection only
+ * changes hands after its thread has exited), so neither the handle nor the
+ * statement cache needs locking.
+ */
+class Connection {
+public:
+    explicit Connection(sqlite3* db) : db(db) {}
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    /**
+     * @brief Returns the prepared statement for @p sql, preparing it on first use.
+     * @param sql The SQL text; also the cache key.
+     * @return The statement, or nullptr if it failed to prepare.
+     */
+    sqlite3_stmt* prepare(const char* sql);
+
+    sqlite3* handle() const { return db; }
+    StatementCacheStats stats() const;
+
+private:
+    sqlite3* db;
+    // Keys view the caller's full SQL text, copied into sql_texts. sqlite3_sql()
+    // cannot be used as the key: it drops anything after the first statement.
+    std::unordered_map<std::string_view, sqlite3_stmt*> statements;
+    std::vector<std::unique_ptr<const std::string>> sql_texts;
+    // Written only by the owning thread; read by stats() from any thread.
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+};
+
+/**
+ * @class ConnectionPool
+ * @brief Hands out one long-lived SQLite connection per calling thread.
+ *
+ * Each httplib worker thread gets its own connection the first time it calls
+ * acquire(). The connection is configured once (WAL journal, pragmas) and
+ * stays with the thread for its lifetime, so requests never pay for
+ * sqlite3_open, schema parsing or a cold page cache. When a thread exits its
+ * connection comes back to the pool: a few are kept for the next new thread
+ * and the rest are closed, so short-lived threads do not pile up connections.
+ */
+class ConnectionPool {
+public:
+    /**
+     * @brief Constructs a pool for the given database file. No connection is opened yet.
+     * @param db_path Path to the SQLite database file.
+     */
+    explicit ConnectionPool(const std::string& db_path);
+
+    /**
+     * @brief Closes every connection opened through this pool.
+     */
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * @brief Returns the calling thread's connection, opening it on first use.
+     * @return The connection, or nullptr if the database could not be opened.
+     */
+    Connection* acquire();
+
+    /**
+     * @brief Sums the statement cache counters of every connection the pool has opened.
+     */
+    StatementCacheStats statementCacheStats();
+
+    // Connections left open for reuse after their threads exit
+    static constexpr size_t MAX_IDLE_CONNECTIONS = 4;
+
+    // Shared with the thread-exit hooks of every thread holding a connection,
+    // which may outlive the pool.
+    struct Connections {
+        std::mutex mtx;
+        bool closed = false;
+        std::vector<std::unique_ptr<Connection>> open;
+        std::vector<Connection*> idle;
+        StatementCacheStats retired; // counters of connections already closed
+
+        void release(Connection* conn);
+    };
+
+private:
+    sqlite3* open();
+
+    std::string db_file;
+    uint64_t pool_id;
+    // Serializes open(): two connections switching a fresh database to WAL
+    // at once can fail with SQLITE_BUSY without invoking the busy handler.
+    std::mutex open_mtx;
+    std::shared_ptr<Connections> connections;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -1,27 +1,337 @@
 #include "DatabaseManager.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "JsonWriter.h"
 #include "sqlite3.h"
-#include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <memory>
 #include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
 #include "Stock.h"
 #include "json.hpp"
-using ordered_json = nlohmann::ordered_json;
 
 
-DatabaseManager::DatabaseManager(const std::string &db_path) : db_file(db_path) {}
+static LatencyHistogram &dbLatency(const char *method)
+{
+    return Metrics::global().histogram("db_call_duration_seconds", "Time spent in DatabaseManager calls.",
+                                       std::string("method=\"") + method + "\"");
+}
+
+static bool hasColumn(sqlite3 *db, const std::string &table, const std::string &column)
+{
+    sqlite3_stmt *stmt = nullptr;
+    bool exists = false;
+    std::string pragma = "PRAGMA table_info(" + table + ");";
+    if (sqlite3_prepare_v2(db, pragma.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            if (column == reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)))
+            {
+                exists = true;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+static bool addColumnIfMissing(sqlite3 *db, const std::string &table, const std::string &column, const std::string &definition)
+{
+    if (hasColumn(db, table, column))
+        return true;
+
+    std::string alter = "ALTER TABLE " + table + " ADD COLUMN " + column + " " + definition + ";";
+    char *errMsg = nullptr;
+    if (sqlite3_exec(db, alter.c_str(), 0, 0, &errMsg) != SQLITE_OK)
+    {
+        Logger::error("Failed to add {}.{}: {}", table, column, errMsg);
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Runs a backfill statement only when the target table has no rows yet, so
+// tables added to an existing database are seeded once from history.
+static bool backfillIfEmpty(sqlite3 *db, const std::string &table, const char *sql)
+{
+    bool empty = true;
+    sqlite3_stmt *stmt = nullptr;
+    std::string probe = "SELECT 1 FROM " + table + " LIMIT 1;";
+    if (sqlite3_prepare_v2(db, probe.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        empty = sqlite3_step(stmt) != SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    if (!empty)
+        return true;
+
+    char *errMsg = nullptr;
+    if (sqlite3_exec(db, sql, 0, 0, &errMsg) != SQLITE_OK)
+    {
+        Logger::error("Failed to backfill {}: {}", table, errMsg);
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Interns the symbol text in a result column without copying it first.
+static SymbolId columnSymbol(sqlite3_stmt *stmt, int column)
+{
+    const char *text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, column));
+    return SymbolTable::global().intern(std::string_view(text, sqlite3_column_bytes(stmt, column)));
+}
+
+// Interns every known ticker up front, so request handlers can resolve
+// symbols with SymbolTable::find() and reject unknown ones without touching
+// the database.
+static bool loadSymbols(sqlite3 *db)
+{
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT Symbol FROM Stock ORDER BY StockID;", -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        Logger::error("Failed to load symbols: {}", sqlite3_errmsg(db));
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        columnSymbol(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+// Appends one trade to UserTransaction, updates the user's Position and
+// applies the cash effect to their Portfolio row, creating the row with the
+// default balance if needed. Refuses a trade whose amount or resulting
+// balance is out of range. Runs inside the caller's transaction.
+static bool appendTrade(Connection &conn, int user_id, SymbolId symbol_id, const std::string &type, int quantity, Money price)
+{
+    const std::string &symbol = SymbolTable::global().name(symbol_id);
+    const char *insert_sql = R"SQL(
+        INSERT INTO UserTransaction (UserID, StockID, TransactionType, Quantity, Price)
+        SELECT ?, StockID, ?, ?, ?
+        FROM Stock
+        WHERE Symbol = ?;
+    )SQL";
+    const char *account_sql = R"SQL(
+        INSERT INTO Portfolio (UserID, CashMicros)
+        SELECT ?1, ?2
+        WHERE NOT EXISTS (SELECT 1 FROM Portfolio WHERE UserID = ?1);
+    )SQL";
+    const char *balance_sql = "SELECT COALESCE((SELECT CashMicros FROM Portfolio WHERE UserID = ?), ?);";
+    const char *cash_sql = "UPDATE Portfolio SET CashMicros = ? WHERE UserID = ?;";
+    const char *buy_sql = R"SQL(
+        INSERT INTO Position (UserID, StockID, Quantity, CostBasisMicros)
+        SELECT ?, StockID, ?, ?
+        FROM Stock
+        WHERE Symbol = ?
+        ON CONFLICT (UserID, StockID) DO UPDATE SET
+            Quantity = Quantity + excluded.Quantity,
+            CostBasisMicros = CostBasisMicros + excluded.CostBasisMicros;
+    )SQL";
+    // Selling releases cost basis at the position's average cost, in integer
+    // micro-units (the remainder stays with the shares still held). It never
+    // sells shares that are not held; the cash credited above is then rolled
+    // back with the caller's transaction.
+    const char *sell_sql = R"SQL(
+        UPDATE Position
+        SET CostBasisMicros = CASE WHEN Quantity > ?1 THEN CostBasisMicros * (Quantity - ?1) / Quantity ELSE 0 END,
+            Quantity = Quantity - ?1
+        WHERE UserID = ?2
+            AND StockID = (SELECT StockID FROM Stock WHERE Symbol = ?3)
+            AND Quantity >= ?1;
+    )SQL";
+
+    Money amount;
+    if (!Money::multiply(price, quantity, amount))
+    {
+        Logger::error("Trade amount out of range.");
+        return false;
+    }
+    {
+        Statement stmt(conn.prepare(insert_sql));
+        if (!stmt)
+            return false;
+        sqlite3_bind_int(stmt.get(), 1, user_id);
+        sqlite3_bind_text(stmt.get(), 2, type.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt.get(), 3, quantity);
+        sqlite3_bind_double(stmt.get(), 4, price.toDouble());
+        sqlite3_bind_text(stmt.get(), 5, symbol.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE || sqlite3_changes(conn.handle()) == 0)
+            return false;
+    }
+    {
+        Statement stmt(conn.prepare(account_sql));
+        if (!stmt)
+            return false;
+        sqlite3_bind_int(stmt.get(), 1, user_id);
+        sqlite3_bind_int64(stmt.get(), 2, DEFAULT_FUND_BALANCE.getMicros());
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+            return false;
+    }
+    {
+        // The new balance is worked out here rather than in SQL, where an
+        // overflow would quietly turn it into a REAL.
+        Money balance;
+        {
+            Statement stmt(conn.prepare(balance_sql));
+            if (!stmt)
+                return false;
+            sqlite3_bind_int(stmt.get(), 1, user_id);
+            sqlite3_bind_int64(stmt.get(), 2, DEFAULT_FUND_BALANCE.getMicros());
+            if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+                return false;
+            balance = Money::fromMicros(sqlite3_column_int64(stmt.get(), 0));
+        }
+        if (!Money::add(balance, type == "buy" ? -amount : amount, balance))
+        {
+            Logger::error("Trade amount out of range.");
+            return false;
+        }
+
+        Statement stmt(conn.prepare(cash_sql));
+        if (!stmt)
+            return false;
+        sqlite3_bind_int64(stmt.get(), 1, balance.getMicros());
+        sqlite3_bind_int(stmt.get(), 2, user_id);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+            return false;
+    }
+    if (type == "buy")
+    {
+        Statement stmt(conn.prepare(buy_sql));
+        if (!stmt)
+            return false;
+        sqlite3_bind_int(stmt.get(), 1, user_id);
+        sqlite3_bind_int(stmt.get(), 2, quantity);
+        sqlite3_bind_int64(stmt.get(), 3, amount.getMicros());
+        sqlite3_bind_text(stmt.get(), 4, symbol.c_str(), -1, SQLITE_STATIC);
+        return sqlite3_step(stmt.get()) == SQLITE_DONE;
+    }
+    else
+    {
+        Statement stmt(conn.prepare(sell_sql));
+        if (!stmt)
+            return false;
+        sqlite3_bind_int(stmt.get(), 1, quantity);
+        sqlite3_bind_int(stmt.get(), 2, user_id);
+        sqlite3_bind_text(stmt.get(), 3, symbol.c_str(), -1, SQLITE_STATIC);
+        return sqlite3_step(stmt.get()) == SQLITE_DONE && sqlite3_changes(conn.handle()) == 1;
+    }
+}
+
+// Whether a fill's account still holds the cash (buy) or shares (sell) for
+// it. Runs inside the caller's transaction.
+static bool fillCovered(Connection &conn, const Fill &fill, bool &covered)
+{
+    const char *cash_sql = "SELECT COALESCE((SELECT CashMicros FROM Portfolio WHERE UserID = ?), ?);";
+    const char *shares_sql = R"SQL(
+        SELECT COALESCE((
+            SELECT p.Quantity
+            FROM Position p
+            JOIN Stock s ON s.StockID = p.StockID
+            WHERE p.UserID = ? AND s.Symbol = ?), 0);
+    )SQL";
+    Statement stmt(conn.prepare(fill.side == Side::Buy ? cash_sql : shares_sql));
+    if (!stmt)
+        return false;
+    sqlite3_bind_int(stmt.get(), 1, fill.user_id);
+    if (fill.side == Side::Buy)
+        sqlite3_bind_int64(stmt.get(), 2, DEFAULT_FUND_BALANCE.getMicros());
+    else
+        sqlite3_bind_text(stmt.get(), 2, SymbolTable::global().name(fill.symbol).c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+        return false;
+
+    int64_t held = sqlite3_column_int64(stmt.get(), 0);
+    Money cost;
+    covered = fill.side == Side::Buy
+        ? Money::multiply(fill.price, fill.quantity, cost) && held >= cost.getMicros()
+        : held >= fill.quantity;
+    return true;
+}
+
+// Adds a fill to its order's filled quantity, completing the order when
+// nothing remains.
+static bool applyFillToOrder(Connection &conn, int64_t order_id, int quantity, int remaining)
+{
+    const char *sql = R"SQL(
+        UPDATE OrderTable
+        SET FilledQuantity = FilledQuantity + ?,
+            Status = CASE WHEN ? = 0 THEN 'completed' ELSE Status END
+        WHERE OrderID = ?;
+    )SQL";
+    Statement stmt(conn.prepare(sql));
+    if (!stmt)
+        return false;
+    sqlite3_bind_int(stmt.get(), 1, quantity);
+    sqlite3_bind_int(stmt.get(), 2, remaining);
+    sqlite3_bind_int64(stmt.get(), 3, order_id);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
+
+// Last journal record already applied to the database; 0 if none.
+static bool readCheckpoint(Connection &conn, const std::string &journal, uint64_t &seq)
+{
+    Statement stmt(conn.prepare("SELECT Seq FROM JournalCheckpoint WHERE Journal = ?;"));
+    if (!stmt)
+        return false;
+    sqlite3_bind_text(stmt.get(), 1, journal.c_str(), -1, SQLITE_TRANSIENT);
+    int rc = sqlite3_step(stmt.get());
+    seq = rc == SQLITE_ROW ? static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0)) : 0;
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+// Applies one journal's records and moves its checkpoint past them.
+static bool projectRecords(Connection &conn, const std::string &journal, const std::vector<JournalRecord> &records)
+{
+    const char *checkpoint_sql = R"SQL(
+        INSERT INTO JournalCheckpoint (Journal, Seq) VALUES (?1, ?2)
+        ON CONFLICT(Journal) DO UPDATE SET Seq = excluded.Seq;
+    )SQL";
+    for (const JournalRecord &record : records)
+    {
+        SymbolId symbol = SymbolTable::global().intern(record.symbol);
+        if (!appendTrade(conn, record.user_id, symbol, record.sell ? "sell" : "buy", record.quantity, Money::fromMicros(record.price_micros)))
+            return false;
+        if (record.order_id != 0 && !applyFillToOrder(conn, record.order_id, record.quantity, record.remaining))
+            return false;
+    }
+
+    Statement stmt(conn.prepare(checkpoint_sql));
+    if (!stmt)
+        return false;
+    sqlite3_bind_text(stmt.get(), 1, journal.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt.get(), 2, static_cast<sqlite3_int64>(records.back().seq));
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
+
+// Journal file of account shard @p index: trades.journal becomes trades.3.journal.
+static std::string shardJournalPath(const std::string &path, size_t index)
+{
+    std::filesystem::path file(path);
+    std::string name = file.stem().string() + "." + std::to_string(index) + file.extension().string();
+    return file.replace_filename(name).string();
+}
+
+DatabaseManager::DatabaseManager(const std::string &db_path) : db_file(db_path), pool(db_path), writer(pool), ingester(writer) {}
 DatabaseManager::~DatabaseManager() {}
 
 bool DatabaseManager::initializeDatabase()
 {
-    sqlite3 *db;
-    if (sqlite3_open(db_file.c_str(), &db) != SQLITE_OK)
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
     {
-        std::cerr << "[ERROR] Can't open database: " << sqlite3_errmsg(db) << std::endl;
         return false;
     }
+    sqlite3 *db = conn->handle();
 
     const char *sql_schema = R"SQL(
         -- User table: stores user information
@@ -54,6 +364,7 @@ bool DatabaseManager::initializeDatabase()
             PortfolioID INTEGER PRIMARY KEY AUTOINCREMENT,
             UserID INTEGER NOT NULL,
             TotalValue REAL DEFAULT 0,
+            CashMicros INTEGER, -- cash balance in Money micro-units
             CreatedAt TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
             FOREIGN KEY (UserID) REFERENCES User(UserID)
         );
@@ -71,6 +382,17 @@ bool DatabaseManager::initializeDatabase()
             FOREIGN KEY (StockID) REFERENCES Stock(StockID)
         );
 
+        -- Position table: current holdings per user, maintained on every fill
+        CREATE TABLE IF NOT EXISTS Position (
+            UserID INTEGER NOT NULL,
+            StockID INTEGER NOT NULL,
+            Quantity INTEGER NOT NULL,
+            CostBasisMicros INTEGER NOT NULL, -- total cost of the shares held, in micro-units
+            PRIMARY KEY (UserID, StockID),
+            FOREIGN KEY (UserID) REFERENCES User(UserID),
+            FOREIGN KEY (StockID) REFERENCES Stock(StockID)
+        ) WITHOUT ROWID;
+
         -- MarketData table: stores market-related data for stocks
         CREATE TABLE IF NOT EXISTS MarketData (
             MarketDataID INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -81,6 +403,36 @@ bool DatabaseManager::initializeDatabase()
             FOREIGN KEY (StockID) REFERENCES Stock(StockID)
         );
 
+        -- LatestQuote table: most recent MarketData row per stock, kept by trigger
+        CREATE TABLE IF NOT EXISTS LatestQuote (
+            StockID INTEGER PRIMARY KEY,
+            MarketDataID INTEGER NOT NULL,
+            Price REAL NOT NULL,
+            Volume INTEGER,
+            Timestamp TIMESTAMP,
+            FOREIGN KEY (StockID) REFERENCES Stock(StockID)
+        );
+
+        -- Maintained on ingest from any writer, including stockdb.py.
+        -- Out-of-order rows never replace a newer quote.
+        CREATE TRIGGER IF NOT EXISTS MarketDataLatestQuote
+        AFTER INSERT ON MarketData
+        BEGIN
+            INSERT INTO LatestQuote (StockID, MarketDataID, Price, Volume, Timestamp)
+            VALUES (NEW.StockID, NEW.MarketDataID, NEW.Price, NEW.Volume, NEW.Timestamp)
+            ON CONFLICT (StockID) DO UPDATE SET
+                MarketDataID = excluded.MarketDataID,
+                Price = excluded.Price,
+                Volume = excluded.Volume,
+                Timestamp = excluded.Timestamp
+            WHERE excluded.Timestamp > LatestQuote.Timestamp
+                OR (excluded.Timestamp = LatestQuote.Timestamp AND excluded.MarketDataID > LatestQuote.MarketDataID);
+        END;
+
+        CREATE INDEX IF NOT EXISTS idx_marketdata_stock_time ON MarketData (StockID, Timestamp);
+        CREATE INDEX IF NOT EXISTS idx_usertransaction_user_stock ON UserTransaction (UserID, StockID);
+        CREATE INDEX IF NOT EXISTS idx_portfolio_user ON Portfolio (UserID);
+
         -- Order table: stores user orders (pending/completed/cancelled)
         CREATE TABLE IF NOT EXISTS OrderTable (
             OrderID INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -90,199 +442,835 @@ bool DatabaseManager::initializeDatabase()
             Quantity INTEGER NOT NULL,
             Price REAL, -- price per share for limit orders
             Status TEXT NOT NULL, -- e.g., pending, completed, canceled
+            Side TEXT NOT NULL DEFAULT 'buy', -- buy or sell
+            FilledQuantity INTEGER NOT NULL DEFAULT 0,
             Timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
             FOREIGN KEY (UserID) REFERENCES User(UserID),
             FOREIGN KEY (StockID) REFERENCES Stock(StockID)
         );
+
+        -- Last trade journal record applied to the tables above, per journal file
+        CREATE TABLE IF NOT EXISTS JournalCheckpoint (
+            Journal TEXT PRIMARY KEY,
+            Seq INTEGER NOT NULL
+        );
+
+        -- Last MarketData row resting orders have been matched against
+        CREATE TABLE IF NOT EXISTS MatchCheckpoint (
+            ID INTEGER PRIMARY KEY CHECK (ID = 1),
+            MarketDataID INTEGER NOT NULL
+        );
     )SQL";
-        
+
     char *errMsg = nullptr;
+
     if (sqlite3_exec(db, sql_schema, 0, 0, &errMsg) != SQLITE_OK)
     {
-        std::cerr << "[ERROR] SQL error: " << errMsg << std::endl;
+        Logger::error("SQL error: {}", errMsg);
         sqlite3_free(errMsg);
-        sqlite3_close(db);
+        return false;
+    }
+
+    // Columns added after the original schema; older databases get them in
+    // place. An account with no CashMicros yet starts from the default balance.
+    if (!addColumnIfMissing(db, "OrderTable", "Side", "TEXT NOT NULL DEFAULT 'buy'") ||
+        !addColumnIfMissing(db, "OrderTable", "FilledQuantity", "INTEGER NOT NULL DEFAULT 0") ||
+        !addColumnIfMissing(db, "Portfolio", "CashMicros", "INTEGER"))
+    {
+        return false;
+    }
+
+    // Databases from before Position existed get it built from their
+    // transactions, with the cost basis at the average buy price.
+    const char *position_backfill = R"SQL(
+        INSERT INTO Position (UserID, StockID, Quantity, CostBasisMicros)
+        SELECT UserID, StockID, Bought - Sold, (Bought - Sold) * BuyCost / Bought
+        FROM (
+            SELECT
+                UserID,
+                StockID,
+                SUM(CASE WHEN TransactionType = 'buy' THEN Quantity ELSE 0 END) AS Bought,
+                SUM(CASE WHEN TransactionType = 'sell' THEN Quantity ELSE 0 END) AS Sold,
+                SUM(CASE WHEN TransactionType = 'buy' THEN Quantity * CAST(ROUND(Price * 1000000) AS INTEGER) ELSE 0 END) AS BuyCost
+            FROM UserTransaction
+            GROUP BY UserID, StockID
+        )
+        WHERE Bought > Sold;
+    )SQL";
+    const char *quote_backfill = R"SQL(
+        INSERT INTO LatestQuote (StockID, MarketDataID, Price, Volume, Timestamp)
+        SELECT md.StockID, md.MarketDataID, md.Price, md.Volume, md.Timestamp
+        FROM MarketData md
+        WHERE md.MarketDataID = (
+            SELECT MarketDataID
+            FROM MarketData
+            WHERE StockID = md.StockID
+            ORDER BY Timestamp DESC, MarketDataID DESC
+            LIMIT 1
+        );
+    )SQL";
+    // Quotes already in the database were matched by the run that ingested them.
+    const char *match_backfill = R"SQL(
+        INSERT INTO MatchCheckpoint (ID, MarketDataID)
+        SELECT 1, COALESCE(MAX(MarketDataID), 0) FROM MarketData;
+    )SQL";
+    if (!backfillIfEmpty(db, "Position", position_backfill) ||
+        !backfillIfEmpty(db, "LatestQuote", quote_backfill) ||
+        !backfillIfEmpty(db, "MatchCheckpoint", match_backfill))
+    {
+        return false;
+    }
+
+    if (!loadSymbols(db))
+    {
         return false;
     }
     
     sqlite3_exec(db, "INSERT OR IGNORE INTO User (UserID, Username, PasswordHash) VALUES (1, 'test', '123');", 0, 0, 0);
 
-    sqlite3_close(db);
     return true;
 }
 
 bool DatabaseManager::addUser(const std::string& username, const std::string& passwordHash, const std::string& email, int& user_id) {
-    sqlite3* db;
-    sqlite3_stmt* stmt;
+    static LatencyHistogram &latency = dbLatency("addUser");
+    ScopedLatency timer(latency);
+    Connection* conn = pool.acquire();
     bool success = false;
 
-    if (sqlite3_open(db_file.c_str(), &db) != SQLITE_OK) return false;
+    if (conn == nullptr) return false;
 
     const char* sql = "INSERT INTO User (Username, Email, PasswordHash) VALUES (?, ?, ?);";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {   
-        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, email.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, passwordHash.c_str(), -1, SQLITE_STATIC);
+    Statement stmt(conn->prepare(sql));
+    if (stmt) {
+        sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, email.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 3, passwordHash.c_str(), -1, SQLITE_STATIC);
         
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
+        if (sqlite3_step(stmt.get()) == SQLITE_DONE) {
             success = true;
-            user_id = static_cast<int>(sqlite3_last_insert_rowid(db));
+            user_id = static_cast<int>(sqlite3_last_insert_rowid(conn->handle()));
         }
     }
-        
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+
     return success;
 }
 
 bool DatabaseManager::validateUser(const std::string &username, const std::string &password, int &user_id)
 {
-    sqlite3 *db;
-    sqlite3_stmt *stmt;
+    static LatencyHistogram &latency = dbLatency("validateUser");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
     bool success = false;
 
-    if (sqlite3_open(db_file.c_str(), &db) != SQLITE_OK)
+    if (conn == nullptr)
         return false;
 
     const char *sql = "SELECT UserID FROM User WHERE Username = ? AND PasswordHash = ?;";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK)
+    Statement stmt(conn->prepare(sql));
+    if (stmt)
     {
-        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, password.c_str(), -1, SQLITE_STATIC);
-        if (sqlite3_step(stmt) == SQLITE_ROW)
+        sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, password.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) == SQLITE_ROW)
         {
-            user_id = sqlite3_column_int(stmt, 0);
+            user_id = sqlite3_column_int(stmt.get(), 0);
             success = true;
         }
     }
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
     return success;
 }
 
-json DatabaseManager::getAllStocksAsJson()
+StatementCacheStats DatabaseManager::getStatementCacheStats()
 {
-    sqlite3 *db;
-    sqlite3_stmt *stmt;
-    ordered_json stocks_array = json::array();
+    return pool.statementCacheStats();
+}
 
-    if (sqlite3_open(db_file.c_str(), &db) != SQLITE_OK)
+bool DatabaseManager::writeAllStocksJson(std::string &out)
+{
+    static LatencyHistogram &latency = dbLatency("writeAllStocksJson");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+
+    if (conn == nullptr)
     {
         throw std::runtime_error("Cannot open database");
     }
 
     const char *sql = R"SQL(
         SELECT 
-            s.Symbol,
             s.CompanyName,
-            md.Price, 
-            md.Volume,
             s.DayHigh,
             s.DayLow,
-            s.PreviousClose,
-            s.PERatio,
             s.DividendYield,
+            s.FiftyTwoWeekHigh,
             s.FiftyTwoWeekLow,
-            s.FiftyTwoWeekHigh
+            s.PERatio,
+            s.PreviousClose,
+            q.Price, 
+            s.Symbol,
+            q.Volume
         FROM 
-            MarketData md
+            LatestQuote q
         JOIN
-            Stock s ON md.StockID = s.StockID;
+            Stock s ON q.StockID = s.StockID;
     )SQL";
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK)
+    // Columns are selected in key order, so each row is written straight
+    // from the statement. Keys are sorted as json::dump() used to sort them.
+    static const char *const KEYS[] = {
+        "\"CompanyName\":", "\"DayHigh\":", "\"DayLow\":", "\"DividendYield\":",
+        "\"FiftyTwoWeekHigh\":", "\"FiftyTwoWeekLow\":", "\"PERatio\":", "\"PreviousClose\":",
+        "\"Price\":", "\"Symbol\":", "\"Volume\":"};
+    const int COMPANY_NAME = 0, SYMBOL = 9, VOLUME = 10, COLUMNS = 11;
+
+    JsonWriter writer(out);
+    writer.beginArray();
+    Statement stmt(conn->prepare(sql));
+    if (!stmt)
     {
-        while (sqlite3_step(stmt) == SQLITE_ROW)
+        Logger::error("Failed to prepare statement for getting all stocks: {}", sqlite3_errmsg(conn->handle()));
+        writer.endArray();
+        return false;
+    }
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+    {
+        writer.beginObject();
+        for (int column = 0; column < COLUMNS; ++column)
         {
-            ordered_json stock_obj;
-            stock_obj["Symbol"] = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
-            stock_obj["CompanyName"] = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
-            stock_obj["Price"] = sqlite3_column_double(stmt, 2);
-            stock_obj["Volume"] = sqlite3_column_int(stmt, 3);
-            stock_obj["DayHigh"] = sqlite3_column_double(stmt, 4);
-            stock_obj["DayLow"] = sqlite3_column_double(stmt, 5);
-            stock_obj["PreviousClose"] = sqlite3_column_double(stmt, 6);
-            stock_obj["PERatio"] = sqlite3_column_double(stmt, 7);
-            stock_obj["DividendYield"] = sqlite3_column_double(stmt, 8);
-            stock_obj["FiftyTwoWeekLow"] = sqlite3_column_double(stmt, 9);
-            stock_obj["FiftyTwoWeekHigh"] = sqlite3_column_double(stmt, 10);
-            stocks_array.push_back(stock_obj);
+            writer.key(KEYS[column]);
+            if (column == COMPANY_NAME || column == SYMBOL)
+                writer.value(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), column)));
+            else if (column == VOLUME)
+                writer.value(sqlite3_column_int(stmt.get(), column));
+            else
+                writer.value(sqlite3_column_double(stmt.get(), column));
         }
+        writer.endObject();
     }
-    else
+    writer.endArray();
+    return true;
+}
+
+std::unique_ptr<StockStream> DatabaseManager::streamStocks(uint32_t fields, const std::string &after, size_t limit)
+{
+    static LatencyHistogram &latency = dbLatency("streamStocks"); // up to the first row
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+
+    if (conn == nullptr)
     {
-        std::cerr << "[ERROR] Failed to prepare statement for getting all stocks: " << sqlite3_errmsg(db) << std::endl;
+        throw std::runtime_error("Cannot open database");
     }
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
-    return stocks_array;
+
+    auto stream = std::make_unique<StockStream>(*conn, fields, after, limit);
+    if (!stream->ok())
+    {
+        return nullptr;
+    }
+    return stream;
 }
 
 bool DatabaseManager::loadPortfolio(int user_id, Portfolio &portfolio)
 {
-    sqlite3* db;
-    sqlite3_stmt* stmt;
-    bool success = false;
+    static LatencyHistogram &latency = dbLatency("loadPortfolio");
+    ScopedLatency timer(latency);
+    if (accounts)
+        return accounts->load(user_id, portfolio);
+    return readPortfolio(user_id, portfolio);
+}
 
-    if (sqlite3_open(db_file.c_str(), &db) != SQLITE_OK) {
+bool DatabaseManager::readPortfolio(int user_id, Portfolio &portfolio)
+{
+    Connection* conn = pool.acquire();
+
+    if (conn == nullptr) {
         return false;
     }
 
+    const char* cash_sql = "SELECT CashMicros FROM Portfolio WHERE UserID = ? AND CashMicros IS NOT NULL;";
+    {
+        Statement stmt(conn->prepare(cash_sql));
+        if (stmt) {
+            sqlite3_bind_int(stmt.get(), 1, user_id);
+            if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+                portfolio.setFundBalance(Money::fromMicros(sqlite3_column_int64(stmt.get(), 0)));
+            }
+        }
+    }
+
+    // Holdings come straight from the materialized Position table
     const char* sql = R"SQL(
         SELECT
             s.Symbol,
-            SUM(CASE WHEN t.TransactionType = 'buy' THEN t.Quantity ELSE 0 END) -
-            SUM(CASE WHEN t.TransactionType = 'sell' THEN t.Quantity ELSE 0 END) AS QuantityHeld,
-            md.Price AS LatestPrice
+            p.Quantity,
+            q.Price,
+            p.CostBasisMicros / p.Quantity AS AverageCostMicros
         FROM
-            UserTransaction t
+            Position p
         JOIN
-            Stock s ON t.StockID = s.StockID
+            Stock s ON p.StockID = s.StockID
         LEFT JOIN
-            MarketData md ON s.StockID = md.StockID
+            LatestQuote q ON p.StockID = q.StockID
         WHERE
-            t.UserID = ?
-            AND md.Timestamp = (
-                SELECT MAX(Timestamp)
-                FROM MarketData
-                WHERE StockID = s.StockID
-            )
-        GROUP BY
-            s.StockID
-        HAVING
-            QuantityHeld > 0;
+            p.UserID = ?
+            AND p.Quantity > 0;
     )SQL";
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, user_id);
+    Statement stmt(conn->prepare(sql));
+    if (stmt) {
+        sqlite3_bind_int(stmt.get(), 1, user_id);
 
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            std::string symbol = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-            int quantity = sqlite3_column_int(stmt, 1);
-            double latestPrice = sqlite3_column_double(stmt, 2);
+        int rc;
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+            SymbolId symbol = columnSymbol(stmt.get(), 0);
+            int quantity = sqlite3_column_int(stmt.get(), 1);
+            // Latest quote, or average cost if the stock has never been quoted
+            Money latestPrice = sqlite3_column_type(stmt.get(), 2) != SQLITE_NULL
+                ? Money::fromDouble(sqlite3_column_double(stmt.get(), 2))
+                : Money::fromMicros(sqlite3_column_int64(stmt.get(), 3));
 
             // Create Stock object using symbol, quantity, latest price
             Stock s(symbol, quantity, latestPrice);
             portfolio.addStock(s);
+        }
+        return rc == SQLITE_DONE;
+    }
 
-            success = true;
+    return false;
+}
+
+
+bool DatabaseManager::savePortfolio(int user_id, const Portfolio &portfolio)
+{
+    static LatencyHistogram &latency = dbLatency("savePortfolio");
+    ScopedLatency timer(latency);
+    const std::vector<Trade> &trades = portfolio.getPendingTrades();
+    if (trades.empty())
+        return true;
+
+    if (accounts)
+        return accounts->commit(user_id, trades);
+
+    // Queued behind concurrent saves and committed with them in one transaction.
+    return writer.execute([&](Connection &conn)
+    {
+        for (const Trade &trade : trades)
+        {
+            if (!appendTrade(conn, user_id, trade.symbol, trade.type, trade.quantity, trade.price))
+                return false;
+        }
+        return true;
+    });
+}
+
+TradeResult DatabaseManager::executeTrade(int user_id, const Trade &trade)
+{
+    static LatencyHistogram &latency = dbLatency("executeTrade");
+    ScopedLatency timer(latency);
+    if (trade.quantity <= 0 || trade.price <= Money())
+        return TradeResult::Rejected;
+    if (accounts)
+        return accounts->execute(user_id, trade);
+    return executeTradeDirect(user_id, trade);
+}
+
+TradeResult DatabaseManager::executeTradeDirect(int user_id, const Trade &trade)
+{
+    // Read, check and write under the account's lock, so concurrent trades
+    // cannot both spend the same balance.
+    std::lock_guard<std::mutex> lock(trade_mtx[static_cast<uint32_t>(user_id) % TRADE_LOCKS]);
+    Portfolio portfolio;
+    if (!readPortfolio(user_id, portfolio))
+        return TradeResult::Failed;
+    bool checked = trade.type == "buy" ? portfolio.buyStock(trade.symbol, trade.quantity, trade.price)
+                                       : portfolio.sellStock(trade.symbol, trade.quantity, trade.price);
+    if (!checked)
+        return TradeResult::Rejected;
+    return savePortfolio(user_id, portfolio) ? TradeResult::Applied : TradeResult::Failed;
+}
+
+GroupCommitStats DatabaseManager::getGroupCommitStats()
+{
+    return writer.stats();
+}
+
+int64_t DatabaseManager::updateStockDatabase(const std::string &csv_path)
+{
+    static LatencyHistogram &latency = dbLatency("updateStockDatabase");
+    ScopedLatency timer(latency);
+    return ingester.submit(csv_path);
+}
+
+bool DatabaseManager::getIngestJob(int64_t job_id, IngestJob &job)
+{
+    static LatencyHistogram &latency = dbLatency("getIngestJob");
+    ScopedLatency timer(latency);
+    return ingester.getJob(job_id, job);
+}
+
+void DatabaseManager::setIngestCompletionHandler(MarketDataIngester::CompletionHandler handler)
+{
+    ingester.setCompletionHandler(std::move(handler));
+}
+
+bool DatabaseManager::insertOrder(const OrderRequest &order, int64_t &order_id)
+{
+    static LatencyHistogram &latency = dbLatency("insertOrder");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+
+    const char *sql = R"SQL(
+        INSERT INTO OrderTable (UserID, StockID, OrderType, Quantity, Price, Status, Side)
+        SELECT ?, StockID, ?, ?, ?, 'pending', ?
+        FROM Stock
+        WHERE Symbol = ?;
+    )SQL";
+    Statement stmt(conn->prepare(sql));
+    if (!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt.get(), 1, order.user_id);
+    sqlite3_bind_text(stmt.get(), 2, order.type == OrderType::Market ? "market" : "limit", -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt.get(), 3, order.quantity);
+    if (order.type == OrderType::Limit)
+        sqlite3_bind_double(stmt.get(), 4, order.limit_price.toDouble());
+    else
+        sqlite3_bind_null(stmt.get(), 4);
+    sqlite3_bind_text(stmt.get(), 5, order.side == Side::Buy ? "buy" : "sell", -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 6, SymbolTable::global().name(order.symbol).c_str(), -1, SQLITE_STATIC);
+
+    // No row is inserted when the symbol is unknown.
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE || sqlite3_changes(conn->handle()) == 0)
+        return false;
+
+    order_id = sqlite3_last_insert_rowid(conn->handle());
+    return true;
+}
+
+bool DatabaseManager::updateOrderStatus(int64_t order_id, const std::string &status)
+{
+    static LatencyHistogram &latency = dbLatency("updateOrderStatus");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+
+    const char *sql = "UPDATE OrderTable SET Status = ? WHERE OrderID = ?;";
+    Statement stmt(conn->prepare(sql));
+    if (!stmt)
+        return false;
+
+    sqlite3_bind_text(stmt.get(), 1, status.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt.get(), 2, order_id);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
+
+bool DatabaseManager::recordFills(const std::vector<Fill> &fills, std::vector<Fill> &refused, std::vector<Fill> &failed)
+{
+    static LatencyHistogram &latency = dbLatency("recordFills");
+    ScopedLatency timer(latency);
+    if (fills.empty())
+        return true;
+    if (accounts)
+        return accounts->settle(fills, refused, failed);
+
+    std::vector<Fill> uncovered;
+    bool ok = writer.execute([&](Connection &conn)
+    {
+        uncovered.clear();
+        for (const Fill &fill : fills)
+        {
+            bool covered = false;
+            if (!fillCovered(conn, fill, covered))
+                return false;
+            if (!covered)
+            {
+                uncovered.push_back(fill);
+                continue;
+            }
+            if (!appendTrade(conn, fill.user_id, fill.symbol, fill.side == Side::Buy ? "buy" : "sell", fill.quantity, fill.price) ||
+                !applyFillToOrder(conn, fill.order_id, fill.quantity, fill.remaining))
+                return false;
         }
+        return true;
+    });
+    // The fills share one transaction, so they were all saved or none were.
+    if (ok)
+        refused.insert(refused.end(), uncovered.begin(), uncovered.end());
+    else
+        failed.insert(failed.end(), fills.begin(), fills.end());
+    return ok;
+}
+
+bool DatabaseManager::openJournal(const std::string &path, size_t shard_count)
+{
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+    if (shard_count == 0)
+        shard_count = std::max(1u, std::thread::hardware_concurrency());
+
+    // A run with more shards left journals past the last one this run uses.
+    // Their accounts now belong to other shards, so they are replayed and
+    // removed before any shard takes a new trade.
+    for (size_t i = shard_count; std::filesystem::exists(shardJournalPath(path, i)); ++i)
+    {
+        std::string name = shardJournalPath(path, i);
+        uint64_t checkpoint = 0;
+        if (!readCheckpoint(*conn, name, checkpoint) || !replayRetiredJournal(name, checkpoint))
+            return false;
     }
 
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<TradeJournal>> opened;
+    std::vector<TradeJournal *> shard_journals;
+    std::vector<uint64_t> checkpoints;
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        names.push_back(shardJournalPath(path, i));
+        checkpoints.push_back(0);
+        if (!readCheckpoint(*conn, names.back(), checkpoints.back()))
+            return false;
+        opened.push_back(std::make_unique<TradeJournal>());
+        if (!opened.back()->open(names.back(), checkpoints.back() + 1))
+        {
+            Logger::error("Failed to open trade journal {}: {}", names.back(), opened.back()->error());
+            return false;
+        }
+        shard_journals.push_back(opened.back().get());
+    }
 
-    return success;
+    journal_names = std::move(names);
+    auto store = std::make_unique<AccountStore>(
+        shard_journals,
+        [this](int user_id, Portfolio &portfolio) { return hydrateAccount(user_id, portfolio); },
+        [this](const std::vector<std::vector<JournalRecord>> &batches) { return projectJournals(batches); });
+    if (!store->start(checkpoints))
+    {
+        store.reset();
+        journal_names.clear();
+        return false;
+    }
+    journals = std::move(opened);
+    accounts = std::move(store);
+    return true;
+}
+
+bool DatabaseManager::replayRetiredJournal(const std::string &path, uint64_t checkpoint)
+{
+    {
+        TradeJournal journal;
+        if (!journal.open(path, checkpoint + 1))
+        {
+            Logger::error("Failed to open trade journal {}: {}", path, journal.error());
+            return false;
+        }
+        if (journal.nextSeq() > checkpoint + 1 && journal.firstSeq() > checkpoint + 1)
+        {
+            Logger::error("Trade journal {} starts at {} but the database stops at {}; records in between are missing.",
+                          path, journal.firstSeq(), checkpoint);
+            return false;
+        }
+        std::vector<JournalRecord> records;
+        for (uint64_t seq = checkpoint + 1; seq < journal.nextSeq(); seq += records.size())
+        {
+            records.clear();
+            journal.read(seq, 4096, records);
+            if (records.empty())
+                break;
+            if (!writer.execute([&](Connection &conn) { return projectRecords(conn, path, records); }))
+            {
+                Logger::error("Failed to replay trade journal {}.", path);
+                return false;
+            }
+        }
+    }
+    Logger::info("Replayed and removed trade journal {}", path);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return true;
 }
 
+bool DatabaseManager::openSnapshot(const std::string &path, PositionColumns &columns, std::vector<Quote> &quotes)
+{
+    if (journals.empty())
+        return false;
 
-bool DatabaseManager::savePortfolio(int user_id, const Portfolio &portfolio)
+    auto loaded = std::make_unique<StateSnapshot>();
+    if (!loaded->open(path))
+    {
+        Logger::warn("No usable snapshot: {}", loaded->error());
+        return false;
+    }
+
+    // The snapshot is only current for accounts the journals have not touched
+    // since; it needs each journal from just after it to tell which those are.
+    const std::vector<uint64_t> &seqs = loaded->seqs();
+    if (seqs.size() != journals.size())
+    {
+        Logger::warn("Snapshot covers {} trade journals but there are {}; ignoring it", seqs.size(), journals.size());
+        return false;
+    }
+    std::unordered_set<int> changed;
+    std::vector<JournalRecord> records;
+    for (size_t i = 0; i < journals.size(); ++i)
+    {
+        uint64_t next = journals[i]->nextSeq();
+        if (seqs[i] + 1 < journals[i]->firstSeq() || seqs[i] >= next)
+        {
+            Logger::warn("Snapshot at {} does not match trade journal {} ({} to {}); ignoring it",
+                         seqs[i], journal_names[i], journals[i]->firstSeq(), next);
+            return false;
+        }
+        for (uint64_t seq = seqs[i] + 1; seq < next; seq += records.size())
+        {
+            records.clear();
+            journals[i]->read(seq, 4096, records);
+            if (records.empty())
+                break;
+            for (const JournalRecord &record : records)
+                changed.insert(record.user_id);
+        }
+    }
+
+    loaded->loadColumns(columns);
+    loaded->loadQuotes(quotes);
+    Logger::info("Loaded snapshot of {} accounts", loaded->accountCount());
+
+    std::lock_guard<std::mutex> lock(snapshot_mtx);
+    snapshot = std::move(loaded);
+    changed_since_snapshot = std::move(changed);
+    return true;
+}
+
+bool DatabaseManager::writeSnapshot(const std::string &path, PositionColumns &columns, std::vector<Quote> &quotes)
+{
+    static LatencyHistogram &latency = dbLatency("writeSnapshot");
+    ScopedLatency timer(latency);
+    std::lock_guard<std::mutex> write_lock(snapshot_write_mtx);
+    Connection *conn = pool.acquire();
+    if (journals.empty() || conn == nullptr)
+        return false;
+
+    // One read transaction, so the checkpoints match the rows exactly.
+    std::vector<uint64_t> seqs(journals.size(), 0);
+    sqlite3_exec(conn->handle(), "BEGIN;", 0, 0, 0);
+    bool loaded = true;
+    for (size_t i = 0; loaded && i < journals.size(); ++i)
+        loaded = readCheckpoint(*conn, journal_names[i], seqs[i]);
+    loaded = loaded && loadPositionColumns(columns) && getLatestQuotes(quotes);
+    sqlite3_exec(conn->handle(), "COMMIT;", 0, 0, 0);
+    if (!loaded)
+        return false;
+
+#ifdef _WIN32
+    // A mapped file cannot be replaced on Windows. Accounts not loaded yet
+    // come from the database instead, which holds the same state.
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mtx);
+        snapshot.reset();
+    }
+#endif
+
+    std::string error;
+    if (!StateSnapshot::write(path, seqs, columns, quotes, error))
+    {
+        Logger::error("Failed to write snapshot: {}", error);
+        return false;
+    }
+    for (size_t i = 0; i < journals.size(); ++i)
+    {
+        if (!journals[i]->discardBefore(seqs[i] + 1))
+            Logger::warn("Failed to trim trade journal {}: {}", journal_names[i], journals[i]->error());
+    }
+    return true;
+}
+
+bool DatabaseManager::hydrateAccount(int user_id, Portfolio &portfolio)
+{
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mtx);
+        if (snapshot && changed_since_snapshot.count(user_id) == 0 && snapshot->loadAccount(user_id, portfolio))
+            return true;
+    }
+    return readPortfolio(user_id, portfolio);
+}
+
+bool DatabaseManager::projectJournals(const std::vector<std::vector<JournalRecord>> &batches)
+{
+    static LatencyHistogram &latency = dbLatency("projectJournal");
+    ScopedLatency timer(latency);
+
+    // The records and the checkpoints that cover them commit together, so a
+    // crash can neither lose a record nor apply one twice.
+    return writer.execute([&](Connection &conn)
+    {
+        for (size_t i = 0; i < batches.size(); ++i)
+        {
+            if (!batches[i].empty() && !projectRecords(conn, journal_names[i], batches[i]))
+                return false;
+        }
+        return true;
+    });
+}
+
+bool DatabaseManager::loadPendingOrders(std::vector<OrderRequest> &orders)
+{
+    static LatencyHistogram &latency = dbLatency("loadPendingOrders");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+
+    const char *sql = R"SQL(
+        SELECT o.OrderID, o.UserID, s.Symbol, o.Side, o.Quantity - o.FilledQuantity, o.Price
+        FROM OrderTable o
+        JOIN Stock s ON o.StockID = s.StockID
+        WHERE o.Status = 'pending' AND o.OrderType = 'limit'
+        ORDER BY o.OrderID;
+    )SQL";
+    Statement stmt(conn->prepare(sql));
+    if (!stmt)
+        return false;
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+    {
+        OrderRequest order;
+        order.order_id = sqlite3_column_int64(stmt.get(), 0);
+        order.user_id = sqlite3_column_int(stmt.get(), 1);
+        order.symbol = columnSymbol(stmt.get(), 2);
+        order.side = std::string(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 3))) == "sell" ? Side::Sell : Side::Buy;
+        order.type = OrderType::Limit;
+        order.quantity = sqlite3_column_int(stmt.get(), 4);
+        order.limit_price = Money::fromDouble(sqlite3_column_double(stmt.get(), 5));
+        orders.push_back(order);
+    }
+    return true;
+}
+
+bool DatabaseManager::getLatestQuotes(std::vector<Quote> &quotes)
 {
-    // Logic to save funds and stocks from the portfolio object for the user_id
-    return true; // placeholder
+    static LatencyHistogram &latency = dbLatency("getLatestQuotes");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+
+    const char *sql = R"SQL(
+        SELECT s.Symbol, q.Price, q.Volume, q.MarketDataID
+        FROM LatestQuote q
+        JOIN Stock s ON q.StockID = s.StockID;
+    )SQL";
+    Statement stmt(conn->prepare(sql));
+    if (!stmt)
+        return false;
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+    {
+        Quote quote;
+        quote.symbol = columnSymbol(stmt.get(), 0);
+        quote.price = Money::fromDouble(sqlite3_column_double(stmt.get(), 1));
+        quote.volume = sqlite3_column_int64(stmt.get(), 2);
+        quote.id = sqlite3_column_int64(stmt.get(), 3);
+        quotes.push_back(quote);
+    }
+    return true;
 }
 
-bool DatabaseManager::updateStockDatabase(const std::string &csv_path)
+bool DatabaseManager::getMatchCheckpoint(int64_t &market_data_id)
 {
-    // Logic to read CSV and update the stocks table
-    return true; // placeholder
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+
+    Statement stmt(conn->prepare("SELECT MarketDataID FROM MatchCheckpoint WHERE ID = 1;"));
+    if (!stmt)
+        return false;
+    int rc = sqlite3_step(stmt.get());
+    market_data_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt.get(), 0) : 0;
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+bool DatabaseManager::setMatchCheckpoint(int64_t market_data_id)
+{
+    return writer.execute([&](Connection &conn)
+    {
+        const char *sql = R"SQL(
+            INSERT INTO MatchCheckpoint (ID, MarketDataID) VALUES (1, ?1)
+            ON CONFLICT (ID) DO UPDATE SET MarketDataID = excluded.MarketDataID;
+        )SQL";
+        Statement stmt(conn.prepare(sql));
+        if (!stmt)
+            return false;
+        sqlite3_bind_int64(stmt.get(), 1, market_data_id);
+        return sqlite3_step(stmt.get()) == SQLITE_DONE;
+    });
+}
+
+bool DatabaseManager::loadPositionColumns(PositionColumns &columns)
+{
+    static LatencyHistogram &latency = dbLatency("loadPositionColumns");
+    ScopedLatency timer(latency);
+    Connection *conn = pool.acquire();
+    if (conn == nullptr)
+        return false;
+
+    const char *account_sql = R"SQL(
+        SELECT u.UserID, u.Username, COALESCE(MAX(p.CashMicros), ?)
+        FROM User u
+        LEFT JOIN Portfolio p ON p.UserID = u.UserID
+        GROUP BY u.UserID
+        ORDER BY u.UserID;
+    )SQL";
+    // Position's primary key keeps this in UserID order without a sort.
+    const char *position_sql = R"SQL(
+        SELECT p.UserID, p.StockID, s.Symbol, p.Quantity, p.CostBasisMicros
+        FROM Position p
+        JOIN Stock s ON p.StockID = s.StockID
+        WHERE p.Quantity > 0
+        ORDER BY p.UserID;
+    )SQL";
+
+    Statement accounts(conn->prepare(account_sql));
+    Statement positions(conn->prepare(position_sql));
+    if (!accounts || !positions)
+        return false;
+    sqlite3_bind_int64(accounts.get(), 1, DEFAULT_FUND_BALANCE.getMicros());
+
+    // StockID -> SymbolId + 1, so each symbol is interned once per load
+    std::vector<SymbolId> symbol_cache;
+
+    columns = PositionColumns();
+    columns.offsets.push_back(0);
+    int position_rc = sqlite3_step(positions.get());
+    while (sqlite3_step(accounts.get()) == SQLITE_ROW)
+    {
+        int user_id = sqlite3_column_int(accounts.get(), 0);
+        columns.user_ids.push_back(user_id);
+        columns.usernames.emplace_back(reinterpret_cast<const char *>(sqlite3_column_text(accounts.get(), 1)));
+        columns.cash.push_back(sqlite3_column_int64(accounts.get(), 2));
+
+        // Skip positions of users that no longer exist, then take this user's
+        for (; position_rc == SQLITE_ROW && sqlite3_column_int(positions.get(), 0) <= user_id;
+             position_rc = sqlite3_step(positions.get()))
+        {
+            if (sqlite3_column_int(positions.get(), 0) < user_id)
+                continue;
+
+            int64_t stock_id = sqlite3_column_int64(positions.get(), 1);
+            if (stock_id < 0)
+                continue;
+            if (static_cast<size_t>(stock_id) >= symbol_cache.size())
+                symbol_cache.resize(stock_id + 1, 0);
+            if (symbol_cache[stock_id] == 0)
+                symbol_cache[stock_id] = columnSymbol(positions.get(), 2) + 1;
+
+            columns.symbols.push_back(symbol_cache[stock_id] - 1);
+            columns.quantities.push_back(sqlite3_column_int64(positions.get(), 3));
+            columns.costs.push_back(sqlite3_column_int64(positions.get(), 4));
+        }
+        columns.offsets.push_back(static_cast<uint32_t>(columns.symbols.size()));
+    }
+    return position_rc == SQLITE_ROW || position_rc == SQLITE_DONE;
 }
@@ -2,7 +2,22 @@
 #define DATABASEMANAGER_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
 #include "Portfolio.h"
+#include "OrderBook.h"
+#include "ConnectionPool.h"
+#include "GroupCommitWriter.h"
+#include "MarketDataIngester.h"
+#include "ValuationEngine.h"
+#include "TradeJournal.h"
+#include "AccountStore.h"
+#include "StateSnapshot.h"
+#include "StockStream.h"
+#include "Quote.h"
 #include "json.hpp" // Include the JSON header
 
 // Use nlohmann::json for convenience
@@ -11,19 +26,97 @@ using json = nlohmann::json;
 class DatabaseManager {
 private:
     std::string db_file;
+    ConnectionPool pool;
+    GroupCommitWriter writer; // after pool: stops before the connections close
+    MarketDataIngester ingester; // after writer: finishes its jobs through it
+    std::vector<std::string> journal_names; // one per account shard
+    std::vector<std::unique_ptr<TradeJournal>> journals;
+    std::mutex snapshot_mtx; // guards the two below
+    std::unique_ptr<StateSnapshot> snapshot;
+    std::unordered_set<int> changed_since_snapshot;
+    std::mutex snapshot_write_mtx;
+    // Direct mode only: without a journal, trades go straight to the tables
+    // and these serialize each account's read, check and write by user id.
+    // Journaled trades are serialized by their account shard instead.
+    static constexpr size_t TRADE_LOCKS = 64;
+    std::mutex trade_mtx[TRADE_LOCKS];
+    std::unique_ptr<AccountStore> accounts; // last: drains its projection through writer
+
+    bool readPortfolio(int user_id, Portfolio& portfolio);
+    bool hydrateAccount(int user_id, Portfolio& portfolio);
+    TradeResult executeTradeDirect(int user_id, const Trade& trade);
+    bool projectJournals(const std::vector<std::vector<JournalRecord>>& batches);
+    bool replayRetiredJournal(const std::string& path, uint64_t checkpoint);
 
 public:
     DatabaseManager(const std::string& db_path);
     ~DatabaseManager();
 
     bool initializeDatabase();
+
+    // Switches to journaled mode: account state is served from memory by
+    // @p shard_count account threads (0 for one per core), each appending its
+    // trades to its own journal, with the tables above kept up to date in the
+    // background. Shard i's journal is @p path with ".i" before the extension
+    // (trades.journal becomes trades.0.journal, trades.1.journal, ...).
+    // Replays any journal tail first, including journals left over from a run
+    // with more shards, which are then removed.
+    bool openJournal(const std::string& path, size_t shard_count = 0);
+
+    // Maps a snapshot written by writeSnapshot() so accounts load from it
+    // instead of the database, and returns its accounts and quotes for a
+    // first valuation. Only used if the journal still holds everything after it.
+    bool openSnapshot(const std::string& path, PositionColumns& columns, std::vector<Quote>& quotes);
+
+    // Reads every account and the latest quotes at one journal checkpoint,
+    // writes them as a snapshot and drops the journal records it covers.
+    // Needs openJournal().
+    bool writeSnapshot(const std::string& path, PositionColumns& columns, std::vector<Quote>& quotes);
+
     bool addUser(const std::string& username, const std::string& passwordHash, const std::string& email, int& user_id);
     bool validateUser(const std::string& username, const std::string& password, int& user_id);
     bool loadPortfolio(int user_id, Portfolio& portfolio);
     bool savePortfolio(int user_id, const Portfolio& portfolio);
-    bool updateStockDatabase(const std::string& csv_path);
+    // Checks and records one buy or sell, serialized with every other trade
+    // of the same account.
+    TradeResult executeTrade(int user_id, const Trade& trade);
+
+    // Queues a background ingest of a quote CSV file and returns its job id,
+    // or 0 if too many ingests are already waiting.
+    int64_t updateStockDatabase(const std::string& csv_path);
+    bool getIngestJob(int64_t job_id, IngestJob& job);
+    void setIngestCompletionHandler(MarketDataIngester::CompletionHandler handler);
+
+    // Appends every stock with its latest quote to @p out as a JSON array.
+    bool writeAllStocksJson(std::string& out);
+
+    // Opens one page of stocks in symbol order, projected to @p fields (see
+    // StockStream). Returns nullptr if the query could not be run.
+    std::unique_ptr<StockStream> streamStocks(uint32_t fields, const std::string& after, size_t limit);
+
+    // Order persistence for the matching engine
+    bool insertOrder(const OrderRequest& order, int64_t& order_id);
+    bool updateOrderStatus(int64_t order_id, const std::string& status);
+    // Fills whose account no longer has the cash or shares for them are not
+    // recorded but added to @p refused; their orders should be canceled.
+    // Fills that could not be saved are added to @p failed.
+    bool recordFills(const std::vector<Fill>& fills, std::vector<Fill>& refused, std::vector<Fill>& failed);
+    bool loadPendingOrders(std::vector<OrderRequest>& orders);
+    bool getLatestQuotes(std::vector<Quote>& quotes);
+
+    // Last quote (Quote::id) resting orders have been matched against, so a
+    // restart or a later ingest does not fill them again on the same quote.
+    bool getMatchCheckpoint(int64_t& market_data_id);
+    bool setMatchCheckpoint(int64_t market_data_id);
+
+    // Every account with its cash and open positions, for batch valuation.
+    bool loadPositionColumns(PositionColumns& columns);
+
+    // Prepared-statement cache hit/miss counters across all pooled connections.
+    StatementCacheStats getStatementCacheStats();
 
-    json getAllStocksAsJson();
+    // Batches and requests committed by the group-commit writer.
+    GroupCommitStats getGroupCommitStats();
 };
 
 #endif // DATABASEMANAGER_H
@@ -0,0 +1,393 @@
+// Must match api_server.cpp: httplib.h is compiled into both, and its inline
+// definitions depend on these.
+#define _WIN32_WINNT 0x0A00
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#define CPPHTTPLIB_LISTEN_BACKLOG 1024
+#include "EventLoopServer.h"
+#include "Logger.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+namespace {
+
+constexpr int MAX_EVENTS = 256;
+constexpr int SWEEP_INTERVAL_MS = 1000;
+constexpr size_t MAX_REQUEST_BYTES = 1 << 20; // headers and body the loop buffers for one request
+constexpr size_t NO_FIT = std::numeric_limits<size_t>::max();
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+// Value of header @p name in a request's header block, trimmed; empty if absent.
+std::string_view headerValue(std::string_view headers, std::string_view name) {
+    size_t at = headers.find("\r\n"); // past the request line
+    while (at != std::string_view::npos && at + 2 < headers.size()) {
+        at += 2;
+        size_t end = std::min(headers.find("\r\n", at), headers.size());
+        std::string_view line = headers.substr(at, end - at);
+        size_t colon = line.find(':');
+        if (colon == name.size() && equalsIgnoreCase(line.substr(0, colon), name)) {
+            std::string_view value = line.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+        at = end;
+    }
+    return {};
+}
+
+// End of a chunked body starting at @p at, or past data.size() while it is
+// still arriving.
+size_t chunkedEnd(std::string_view data, size_t at) {
+    while (true) {
+        size_t line_end = data.find("\r\n", at);
+        if (line_end == std::string_view::npos) return data.size() + 1;
+        size_t size = 0;
+        size_t digits = 0;
+        for (size_t i = at; i < line_end && std::isxdigit(static_cast<unsigned char>(data[i])); ++i, ++digits) {
+            if (size > MAX_REQUEST_BYTES) return NO_FIT;
+            int c = std::tolower(static_cast<unsigned char>(data[i]));
+            size = size * 16 + static_cast<size_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+        }
+        if (digits == 0) return line_end; // malformed; let httplib reject it
+        at = line_end + 2;
+        if (size == 0) {
+            // Optional trailers, then an empty line
+            while (true) {
+                size_t end = data.find("\r\n", at);
+                if (end == std::string_view::npos) return data.size() + 1;
+                if (end == at) return at + 2;
+                at = end + 2;
+            }
+        }
+        if (size > MAX_REQUEST_BYTES) return NO_FIT;
+        at += size + 2;
+        if (at > data.size()) return at;
+    }
+}
+
+// Bytes the first request in @p data takes: its headers plus, going by
+// Content-Length or chunked framing, its body. 0 while the headers are still
+// arriving, more than data.size() while the body is, and NO_FIT once it is
+// known not to fit in MAX_REQUEST_BYTES. A request that cannot be framed counts
+// as complete, so httplib answers it with the usual error.
+size_t requestLength(std::string_view data) {
+    size_t headers_end = data.find("\r\n\r\n");
+    if (headers_end == std::string_view::npos) return data.size() > MAX_REQUEST_BYTES ? NO_FIT : 0;
+    size_t body = headers_end + 4;
+    std::string_view headers = data.substr(0, body);
+
+    if (equalsIgnoreCase(headerValue(headers, "Transfer-Encoding"), "chunked")) return chunkedEnd(data, body);
+    std::string_view length = headerValue(headers, "Content-Length");
+    size_t content_length = 0;
+    for (char c : length) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return body;
+        content_length = content_length * 10 + (c - '0');
+        if (content_length > MAX_REQUEST_BYTES) return NO_FIT;
+    }
+    return body + content_length;
+}
+
+bool complete(std::string_view data) {
+    size_t length = requestLength(data);
+    return length != 0 && length <= data.size();
+}
+
+// A worker's view of a connection. Requests are read from what the event
+// loop has already received in full, so reading never waits on the client;
+// responses go straight to the socket.
+class RequestStream final : public httplib::Stream {
+public:
+    RequestStream(socket_t sock, const std::string& received, time_t write_timeout_sec, time_t write_timeout_usec)
+        : received(received), socket_stream(sock, 0, 0, write_timeout_sec, write_timeout_usec) {}
+
+    bool is_readable() const override { return offset < received.size(); }
+    bool wait_readable() const override { return is_readable(); }
+    bool wait_writable() const override { return socket_stream.wait_writable(); }
+
+    ssize_t read(char* ptr, size_t size) override {
+        size_t n = std::min(size, received.size() - offset);
+        std::memcpy(ptr, received.data() + offset, n);
+        offset += n;
+        return static_cast<ssize_t>(n);
+    }
+    ssize_t write(const char* ptr, size_t size) override { return socket_stream.write(ptr, size); }
+
+    void get_remote_ip_and_port(std::string& ip, int& port) const override {
+        socket_stream.get_remote_ip_and_port(ip, port);
+    }
+    void get_local_ip_and_port(std::string& ip, int& port) const override {
+        socket_stream.get_local_ip_and_port(ip, port);
+    }
+    socket_t socket() const override { return socket_stream.socket(); }
+    time_t duration() const override { return socket_stream.duration(); }
+
+    std::string_view unread() const { return std::string_view(received).substr(offset); }
+
+private:
+    const std::string& received;
+    size_t offset = 0;
+    httplib::detail::SocketStream socket_stream;
+};
+
+// Runs each task on the calling thread. The accept loop's only task is to
+// call process_and_close_socket(), which here just registers the socket.
+class InlineQueue : public httplib::TaskQueue {
+public:
+    bool enqueue(std::function<void()> fn) override {
+        fn();
+        return true;
+    }
+    void shutdown() override {}
+};
+
+// Set while a worker is in serve(); handOver() leaves its callback here.
+thread_local bool serving = false;
+thread_local std::function<void(socket_t)> pending_handover;
+
+} // namespace
+
+bool EventLoopServer::handOver(std::function<void(socket_t)> adopt) {
+    if (!serving) return false;
+    pending_handover = std::move(adopt);
+    return true;
+}
+
+EventLoopServer::EventLoopServer(size_t threads, size_t max_queued_requests)
+    : workers(threads, max_queued_requests) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd;
+    if (epoll_fd < 0 || wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0) {
+        Logger::error("Failed to create the connection event loop");
+    }
+    new_task_queue = [] { return new InlineQueue(); };
+    loop = std::thread(&EventLoopServer::run, this);
+}
+
+EventLoopServer::~EventLoopServer() {
+    stopping = true;
+    uint64_t one = 1;
+    ssize_t woken = write(wake_fd, &one, sizeof(one));
+    (void)woken; // if this fails the loop still stops within one sweep interval
+    loop.join();
+    workers.shutdown();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    while (!connections.empty()) {
+        closeConnection(connections.begin()->first);
+    }
+    close(wake_fd);
+    close(epoll_fd);
+}
+
+bool EventLoopServer::process_and_close_socket(socket_t sock) {
+    std::lock_guard<std::mutex> lock(mtx);
+    connections[sock] = Connection{std::chrono::steady_clock::now()};
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.fd = sock;
+    if (stopping || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &event) != 0) {
+        closeConnection(sock);
+        return false;
+    }
+    return true;
+}
+
+void EventLoopServer::run() {
+    epoll_event events[MAX_EVENTS];
+    auto next_sweep = std::chrono::steady_clock::now();
+    while (!stopping) {
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, SWEEP_INTERVAL_MS);
+        for (int i = 0; i < count; ++i) {
+            socket_t sock = events[i].data.fd;
+            if (sock == wake_fd) continue;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = connections.find(sock);
+                if (it == connections.end()) continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(sock);
+                    continue;
+                }
+                if (!receive(sock, it->second)) continue;
+                it->second.busy = true;
+            }
+            if (!workers.enqueue([this, sock] { serve(sock); })) {
+                std::lock_guard<std::mutex> lock(mtx);
+                reject(sock, "HTTP/1.1 503 Service Unavailable\r\n");
+            }
+        }
+
+        // Close connections parked longer than the keep-alive timeout, or
+        // still sending a request after the read timeout
+        auto now = std::chrono::steady_clock::now();
+        if (now < next_sweep) continue;
+        next_sweep = now + std::chrono::milliseconds(SWEEP_INTERVAL_MS);
+        auto keep_alive_timeout = std::chrono::seconds(keep_alive_timeout_sec_);
+        auto read_timeout = std::chrono::seconds(read_timeout_sec_) + std::chrono::microseconds(read_timeout_usec_);
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto it = connections.begin(); it != connections.end();) {
+            socket_t sock = it->first;
+            const Connection& connection = it->second;
+            bool expired = !connection.busy &&
+                           now - connection.idle_since > (connection.received.empty() ? keep_alive_timeout : read_timeout);
+            ++it;
+            if (expired) closeConnection(sock);
+        }
+    }
+}
+
+bool EventLoopServer::receive(socket_t sock, Connection& connection) {
+    bool started = connection.received.empty();
+    bool closed = false;
+    char chunk[16384];
+    while (connection.received.size() <= MAX_REQUEST_BYTES) {
+        ssize_t n = recv(sock, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (n > 0) {
+            connection.received.append(chunk, static_cast<size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+    }
+    if (started && !connection.received.empty()) connection.idle_since = std::chrono::steady_clock::now();
+
+    size_t length = requestLength(connection.received);
+    if (length != 0 && length <= connection.received.size()) return true;
+    if (length == NO_FIT || connection.received.size() > MAX_REQUEST_BYTES) {
+        reject(sock, "HTTP/1.1 413 Payload Too Large\r\n");
+        return false;
+    }
+    if (closed) {
+        closeConnection(sock);
+        return false;
+    }
+    // The headers are in but the client is waiting to be asked for the body.
+    if (length != 0 && !connection.continued &&
+        equalsIgnoreCase(headerValue(connection.received, "Expect"), "100-continue")) {
+        static const char response[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        httplib::detail::send_socket(sock, response, sizeof(response) - 1, 0);
+        connection.continued = true;
+    }
+    park(sock);
+    return false;
+}
+
+void EventLoopServer::serve(socket_t sock) {
+    size_t served;
+    std::string received;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Connection& connection = connections[sock];
+        served = connection.served;
+        received.swap(connection.received);
+        connection.continued = false;
+    }
+
+    std::string remote_addr, local_addr;
+    int remote_port = 0, local_port = 0;
+    httplib::detail::get_remote_ip_and_port(sock, remote_addr, remote_port);
+    httplib::detail::get_local_ip_and_port(sock, local_addr, local_port);
+    RequestStream strm(sock, received, write_timeout_sec_, write_timeout_usec_);
+
+    // Serve every whole request the loop has received, then go back to waiting.
+    bool keep_open = true;
+    serving = true;
+    do {
+        bool close_connection = ++served >= keep_alive_max_count_;
+        bool connection_closed = false;
+        bool written = process_request(strm, remote_addr, remote_port, local_addr, local_port,
+                                       close_connection, connection_closed, nullptr);
+        if (pending_handover) {
+            auto adopt = std::move(pending_handover);
+            pending_handover = nullptr;
+            serving = false;
+            if (written) {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, nullptr);
+                    connections.erase(sock);
+                }
+                adopt(sock);
+                return;
+            }
+            keep_open = false;
+            break;
+        }
+        if (!written || close_connection || connection_closed) {
+            keep_open = false;
+            break;
+        }
+    } while (complete(strm.unread()));
+    serving = false;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!keep_open || stopping) {
+        closeConnection(sock);
+        return;
+    }
+    Connection& connection = connections[sock];
+    connection.received.assign(strm.unread());
+    connection.served = served;
+    connection.busy = false;
+    connection.idle_since = std::chrono::steady_clock::now();
+    park(sock);
+}
+
+void EventLoopServer::park(socket_t sock) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.fd = sock;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sock, &event) != 0) {
+        closeConnection(sock);
+    }
+}
+
+void EventLoopServer::reject(socket_t sock, const char* status_line) {
+    std::string response = std::string(status_line) + "Content-Length: 0\r\nConnection: close\r\n\r\n";
+    httplib::detail::send_socket(sock, response.data(), response.size(), 0);
+    closeConnection(sock);
+}
+
+void EventLoopServer::closeConnection(socket_t sock) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, nullptr);
+    httplib::detail::shutdown_socket(sock);
+    httplib::detail::close_socket(sock);
+    connections.erase(sock);
+}
+
+#else
+
+EventLoopServer::EventLoopServer(size_t threads, size_t max_queued_requests) {
+    new_task_queue = [threads, max_queued_requests] {
+        return new httplib::ThreadPool(threads, max_queued_requests);
+    };
+}
+
+EventLoopServer::~EventLoopServer() = default;
+
+bool EventLoopServer::handOver(std::function<void(socket_t)>) {
+    return false;
+}
+
+#endif
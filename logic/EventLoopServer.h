@@ -0,0 +1,81 @@
+#ifndef EVENTLOOPSERVER_H
+#define EVENTLOOPSERVER_H
+
+#include <unordered_map>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include "httplib.h"
+
+/**
+ * @class EventLoopServer
+ * @brief httplib::Server that holds worker threads only while a request is
+ *        being served.
+ *
+ * Stock httplib gives each connection a worker for its whole keep-alive
+ * lifetime, so idle clients can occupy every thread. Here accepted sockets
+ * are handed to an epoll loop instead. The loop reads whatever arrives
+ * without blocking and buffers it until a whole request, headers and body,
+ * is in hand; only then is the connection queued on a bounded worker pool,
+ * which serves every complete request buffered on it and then parks it back
+ * in the loop. A client that sends its request slowly therefore holds a
+ * buffer, never a worker. Parked connections are closed after the
+ * keep-alive timeout, or after the read timeout once part of a request has
+ * arrived. Requests over 1 MiB get a 413, and when the queue is full new
+ * requests get a 503; either way their connection is closed.
+ *
+ * On platforms without epoll this falls back to httplib's own model, still
+ * with the bounded pool.
+ */
+class EventLoopServer : public httplib::Server {
+public:
+    /**
+     * @param threads Request workers.
+     * @param max_queued_requests Readable connections waiting for a worker; 0 is unbounded.
+     */
+    EventLoopServer(size_t threads, size_t max_queued_requests);
+    ~EventLoopServer() override;
+
+    /**
+     * @brief Called from a request handler to take the connection away from
+     *        the server once the response headers and body have been written.
+     *        @p adopt then owns the socket; it is neither parked nor closed.
+     * @return false when the request is not being served by an event loop,
+     *         in which case the handler has to serve it in place.
+     */
+    static bool handOver(std::function<void(socket_t)> adopt);
+
+private:
+#ifdef __linux__
+    struct Connection {
+        // Parked since, or with part of a request buffered, when it began to arrive
+        std::chrono::steady_clock::time_point idle_since;
+        std::string received; // read but not yet served; owned by whoever holds the connection
+        size_t served = 0;
+        bool busy = false;
+        bool continued = false; // sent 100 Continue for the buffered request
+    };
+
+    bool process_and_close_socket(socket_t sock) override;
+    void run();
+    bool receive(socket_t sock, Connection& connection); // mtx held
+    void serve(socket_t sock);
+    void park(socket_t sock);                            // mtx held
+    void reject(socket_t sock, const char* status_line); // mtx held
+    void closeConnection(socket_t sock);                 // mtx held
+
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::mutex mtx;
+    std::unordered_map<socket_t, Connection> connections;
+    httplib::ThreadPool workers;
+    std::atomic<bool> stopping{false};
+    std::thread loop;
+#endif
+};
+
+#endif // EVENTLOOPSERVER_H
@@ -0,0 +1,124 @@
+#include "GroupCommitWriter.h"
+#include "Logger.h"
+#include "sqlite3.h"
+
+GroupCommitWriter::GroupCommitWriter(ConnectionPool& pool)
+    : pool(pool), worker(&GroupCommitWriter::run, this) {}
+
+GroupCommitWriter::~GroupCommitWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+bool GroupCommitWriter::execute(Work work) {
+    return submit(std::move(work)).get();
+}
+
+std::future<bool> GroupCommitWriter::submit(Work work, bool bulk) {
+    auto request = std::make_unique<Request>();
+    request->work = std::move(work);
+    request->bulk = bulk;
+    std::future<bool> result = request->done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.push_back(std::move(request));
+    }
+    cv.notify_one();
+    return result;
+}
+
+GroupCommitStats GroupCommitWriter::stats() const {
+    GroupCommitStats s;
+    s.batches = batches.load(std::memory_order_relaxed);
+    s.requests = requests.load(std::memory_order_relaxed);
+    return s;
+}
+
+void GroupCommitWriter::run() {
+    Connection* conn = pool.acquire();
+    if (conn != nullptr) {
+        // Every commit from this thread covers a whole batch, so make it a real fsync.
+        sqlite3_exec(conn->handle(), "PRAGMA synchronous = FULL;", 0, 0, 0);
+    }
+
+    Batch pending;
+    Batch batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) break;
+            pending.swap(queue);
+        }
+
+        if (conn == nullptr) {
+            for (auto& request : pending) request->done.set_value(false);
+            pending.clear();
+            continue;
+        }
+
+        // Consecutive small requests share a transaction; bulk requests get their own.
+        for (auto& request : pending) {
+            if (request->bulk) {
+                if (!batch.empty()) commitBatch(*conn, batch, true);
+                batch.push_back(std::move(request));
+                commitBatch(*conn, batch, false);
+            } else {
+                batch.push_back(std::move(request));
+            }
+        }
+        if (!batch.empty()) commitBatch(*conn, batch, true);
+        pending.clear();
+    }
+}
+
+void GroupCommitWriter::commitBatch(Connection& conn, Batch& batch, bool savepoints) {
+    sqlite3* db = conn.handle();
+    std::vector<bool> results(batch.size(), false);
+
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", 0, 0, 0) != SQLITE_OK) {
+        Logger::error("Failed to begin write batch: {}", sqlite3_errmsg(db));
+        for (auto& request : batch) request->done.set_value(false);
+        batch.clear();
+        return;
+    }
+
+    bool all_ok = true;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (savepoints) sqlite3_exec(db, "SAVEPOINT work;", 0, 0, 0);
+        bool ok = false;
+        try {
+            ok = batch[i]->work(conn);
+        } catch (const std::exception& e) {
+            Logger::error("Write failed: {}", e.what());
+        }
+        if (savepoints) {
+            if (!ok) {
+                sqlite3_exec(db, "ROLLBACK TO work;", 0, 0, 0);
+            }
+            sqlite3_exec(db, "RELEASE work;", 0, 0, 0);
+        }
+        results[i] = ok;
+        all_ok = all_ok && ok;
+    }
+
+    // Without savepoints a failed unit can only be undone with the whole transaction.
+    bool committed = (savepoints || all_ok) && sqlite3_exec(db, "COMMIT;", 0, 0, 0) == SQLITE_OK;
+    if (!committed) {
+        if (savepoints || all_ok) {
+            Logger::error("Failed to commit write batch: {}", sqlite3_errmsg(db));
+        }
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+    }
+
+    batches.fetch_add(1, std::memory_order_relaxed);
+    requests.fetch_add(batch.size(), std::memory_order_relaxed);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i]->done.set_value(committed && results[i]);
+    }
+    batch.clear();
+}
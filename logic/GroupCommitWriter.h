@@ -0,0 +1,88 @@
+#ifndef GROUPCOMMITWRITER_H
+#define GROUPCOMMITWRITER_H
+
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "ConnectionPool.h"
+
+/**
+ * @struct GroupCommitStats
+ * @brief How many requests were committed and in how many transactions.
+ */
+struct GroupCommitStats {
+    uint64_t batches = 0;
+    uint64_t requests = 0;
+};
+
+/**
+ * @class GroupCommitWriter
+ * @brief Serializes database writes onto one thread and commits them in batches.
+ *
+ * Callers hand in a unit of work and block until it is durable. While one
+ * batch is committing, new work queues up; the writer then runs the whole
+ * queue inside a single BEGIN IMMEDIATE transaction, so concurrent writers
+ * share one fsync. Each unit runs under its own savepoint, so a failing unit
+ * is rolled back without affecting the rest of its batch. Bulk units skip the
+ * savepoint and are committed alone.
+ */
+class GroupCommitWriter {
+public:
+    // A unit of work. Returns false to roll back its own changes.
+    using Work = std::function<bool(Connection&)>;
+
+    explicit GroupCommitWriter(ConnectionPool& pool);
+
+    /**
+     * @brief Drains any queued work, then stops the writer thread.
+     */
+    ~GroupCommitWriter();
+
+    GroupCommitWriter(const GroupCommitWriter&) = delete;
+    GroupCommitWriter& operator=(const GroupCommitWriter&) = delete;
+
+    /**
+     * @brief Runs @p work in the next batch and waits for that batch to commit.
+     * @return true if the work succeeded and its batch committed.
+     */
+    bool execute(Work work);
+
+    /**
+     * @brief Queues @p work without waiting for it.
+     * @param bulk Run the work in a transaction of its own with no savepoint.
+     *             Meant for large loads, where the savepoint's statement
+     *             journal would cost more than the writes themselves.
+     * @return Resolves to true once the work has succeeded and committed.
+     */
+    std::future<bool> submit(Work work, bool bulk = false);
+
+    GroupCommitStats stats() const;
+
+private:
+    struct Request {
+        Work work;
+        bool bulk;
+        std::promise<bool> done;
+    };
+    using Batch = std::vector<std::unique_ptr<Request>>;
+
+    void run();
+    void commitBatch(Connection& conn, Batch& batch, bool savepoints);
+
+    ConnectionPool& pool;
+    std::mutex mtx;
+    std::condition_variable cv;
+    Batch queue;
+    bool stopping = false;
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> requests{0};
+    std::thread worker;
+};
+
+#endif // GROUPCOMMITWRITER_H
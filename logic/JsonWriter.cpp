@@ -0,0 +1,114 @@
+#include "JsonWriter.h"
+#include <cmath>
+
+void JsonWriter::value(std::string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+    separate();
+    out += '"';
+    size_t run = 0; // start of the pending unescaped run
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(text.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0xF];
+        }
+    }
+    out.append(text.data() + run, text.size() - run);
+    out += '"';
+}
+
+void JsonWriter::value(double number) {
+    separate();
+    if (!std::isfinite(number)) {
+        out += "null";
+        return;
+    }
+
+    // Shortest round-trip digits, then laid out as nlohmann::json does:
+    // plain decimals with a ".0" on whole numbers while the decimal point is
+    // within 15 digits, otherwise d.ddde+XX.
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number, std::chars_format::scientific);
+    std::string_view text(buffer, result.ptr - buffer);
+    if (text[0] == '-') {
+        out += '-';
+        text.remove_prefix(1);
+    }
+    size_t e = text.find('e');
+    int exponent = 0;
+    std::from_chars(text.data() + e + 2, text.data() + text.size(), exponent);
+    if (text[e + 1] == '-') exponent = -exponent;
+
+    char digits[20];
+    int k = 0;
+    for (size_t i = 0; i < e; ++i) {
+        if (text[i] != '.') digits[k++] = text[i];
+    }
+    int n = exponent + 1; // digits before the decimal point
+
+    if (k <= n && n <= 15) {
+        out.append(digits, k);
+        out.append(n - k, '0');
+        out += ".0";
+    } else if (0 < n && n <= 15) {
+        out.append(digits, n);
+        out += '.';
+        out.append(digits + n, k - n);
+    } else if (-4 < n && n <= 0) {
+        out += "0.";
+        out.append(-n, '0');
+        out.append(digits, k);
+    } else {
+        out += digits[0];
+        if (k > 1) {
+            out += '.';
+            out.append(digits + 1, k - 1);
+        }
+        out += exponent < 0 ? "e-" : "e+";
+        int magnitude = exponent < 0 ? -exponent : exponent;
+        if (magnitude < 10) out += '0';
+        char exp_buffer[8];
+        auto exp_result = std::to_chars(exp_buffer, exp_buffer + sizeof(exp_buffer), magnitude);
+        out.append(exp_buffer, exp_result.ptr - exp_buffer);
+    }
+}
+
+void JsonWriter::value(Money amount) {
+    int64_t micros = amount.getMicros();
+    int64_t magnitude = micros < 0 ? -micros : micros;
+    // Below a thousandth dump() switches to an exponent, and from 10^15
+    // micro-units up a double no longer holds every digit: leave those to the
+    // double path. Everything in between is plain digits.
+    if (magnitude != 0 && (magnitude < 1000 || magnitude >= 1000000000000000LL)) {
+        value(amount.toDouble());
+        return;
+    }
+    separate();
+    char buffer[32];
+    char* end = buffer;
+    if (micros < 0) *end++ = '-';
+    end = std::to_chars(end, buffer + sizeof(buffer), magnitude / Money::SCALE).ptr;
+    *end++ = '.';
+    int64_t fraction = magnitude % Money::SCALE;
+    if (fraction == 0) {
+        *end++ = '0';
+    } else {
+        for (int64_t digit = Money::SCALE / 10; fraction != 0; digit /= 10) {
+            *end++ = static_cast<char>('0' + fraction / digit);
+            fraction %= digit;
+        }
+    }
+    out.append(buffer, end - buffer);
+}
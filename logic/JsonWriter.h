@@ -0,0 +1,109 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include "Money.h"
+
+/**
+ * @class JsonWriter
+ * @brief Streams JSON text straight into a caller-owned buffer.
+ *
+ * No document tree is built: values are formatted where they are and
+ * appended. Keys are passed as pre-encoded fragments ("\"symbol\":"), so a
+ * field costs one copy and no escaping. Commas are inserted automatically.
+ * Reusing the same buffer (for instance one per thread) means steady-state
+ * writes allocate nothing.
+ *
+ * Output matches nlohmann::json::dump(): the same escaping, ".0" on whole
+ * doubles, null for NaN and infinity. Doubles use the shortest digits that
+ * round-trip, which now and then is one digit shorter than dump()'s
+ * (0.535302 rather than 0.5353019999999999) but parses to the same value.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out(out) {}
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    /**
+     * @brief Starts an object member. @p fragment is its quoted key and colon.
+     */
+    void key(std::string_view fragment) {
+        separate();
+        out.append(fragment.data(), fragment.size());
+        pending_value = true;
+    }
+
+    void value(std::string_view text);
+    void value(const char* text) { text == nullptr ? null() : value(std::string_view(text)); }
+    void value(double number);
+    // Formatted from the integer micro-units, the same text as value(toDouble()).
+    void value(Money amount);
+    void value(int64_t number) {
+        separate();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, result.ptr - buffer);
+    }
+    void value(uint64_t number) {
+        separate();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, result.ptr - buffer);
+    }
+    void value(int number) { value(static_cast<int64_t>(number)); }
+    void value(bool flag) {
+        separate();
+        out += flag ? "true" : "false";
+    }
+    void null() {
+        separate();
+        out += "null";
+    }
+
+    /**
+     * @brief Appends already-serialized JSON as the next value.
+     */
+    void raw(std::string_view json) {
+        separate();
+        out.append(json.data(), json.size());
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 32; // deeper nesting is not supported
+
+    void separate() {
+        if (pending_value) {
+            pending_value = false;
+            return;
+        }
+        if (depth > 0 && has_items[depth - 1]) out += ',';
+        if (depth > 0) has_items[depth - 1] = true;
+    }
+    void open(char bracket) {
+        separate();
+        out += bracket;
+        if (depth < MAX_DEPTH) has_items[depth] = false;
+        ++depth;
+    }
+    void close(char bracket) {
+        --depth;
+        out += bracket;
+    }
+
+    std::string& out;
+    int depth = 0;
+    bool pending_value = false; // a key was written; the next value follows it directly
+    bool has_items[MAX_DEPTH];
+};
+
+#endif // JSONWRITER_H
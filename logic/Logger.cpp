@@ -0,0 +1,212 @@
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <cctype>
+
+namespace {
+
+constexpr const char* LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR", "FATAL", "OFF"};
+
+// How long the drain thread sleeps when every ring is empty.
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(2);
+
+void appendTime(std::string& out, int64_t time_ns) {
+    std::time_t seconds = static_cast<std::time_t>(time_ns / 1000000000);
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ ",
+                  utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
+                  static_cast<int>(time_ns % 1000000000 / 1000));
+    out += buffer;
+}
+
+// Appends one decoded argument and returns the bytes it took, or 0 if the
+// payload is exhausted.
+size_t appendArgument(std::string& out, const uint8_t* data, size_t size) {
+    if (size == 0) return 0;
+    char buffer[32];
+    switch (data[0]) {
+    case LogEncoder::Signed: {
+        int64_t value;
+        std::memcpy(&value, data + 1, sizeof(value));
+        std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+        out += buffer;
+        return 1 + sizeof(value);
+    }
+    case LogEncoder::Unsigned: {
+        uint64_t value;
+        std::memcpy(&value, data + 1, sizeof(value));
+        std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+        out += buffer;
+        return 1 + sizeof(value);
+    }
+    case LogEncoder::Double: {
+        double value;
+        std::memcpy(&value, data + 1, sizeof(value));
+        std::snprintf(buffer, sizeof(buffer), "%g", value);
+        out += buffer;
+        return 1 + sizeof(value);
+    }
+    case LogEncoder::Bool:
+        out += data[1] != 0 ? "true" : "false";
+        return 2;
+    case LogEncoder::Text: {
+        size_t length = data[1];
+        out.append(reinterpret_cast<const char*>(data + 2), length);
+        return 2 + length;
+    }
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+bool parseLogLevel(const std::string& name, LogLevel& level) {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    for (size_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); ++i) {
+        if (upper == LEVEL_NAMES[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* logLevelName(LogLevel level) {
+    return LEVEL_NAMES[static_cast<size_t>(level)];
+}
+
+void LogEncoder::add(std::string_view value) {
+    if (used + 2 > capacity) return;
+    size_t length = std::min({value.size(), capacity - used - 2, size_t(255)});
+    out[used++] = Text;
+    out[used++] = static_cast<uint8_t>(length);
+    std::memcpy(out + used, value.data(), length);
+    used += length;
+}
+
+Logger& Logger::global() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() {
+    worker = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+    drain();
+}
+
+Logger::Ring& Logger::localRing() {
+    // The ring outlives its thread; the drain thread frees it once it has
+    // been emptied.
+    struct Owner {
+        Ring* ring = nullptr;
+        ~Owner() {
+            if (ring != nullptr) ring->retired.store(true, std::memory_order_release);
+        }
+    };
+    thread_local Owner owner;
+    if (owner.ring == nullptr) {
+        std::unique_ptr<Ring> ring(new Ring());
+        owner.ring = ring.get();
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        rings.push_back(std::move(ring));
+    }
+    return *owner.ring;
+}
+
+void Logger::flush() {
+    drain();
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopping) {
+        lock.unlock();
+        drain();
+        lock.lock();
+        cv.wait_for(lock, DRAIN_INTERVAL, [this] { return stopping; });
+    }
+}
+
+void Logger::drain() {
+    std::lock_guard<std::mutex> drain_lock(drain_mtx);
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        for (auto it = rings.begin(); it != rings.end();) {
+            Ring& ring = **it;
+            // Read retired first: a ring retired before its last records
+            // were seen is drained once more before it is freed.
+            bool retired = ring.retired.load(std::memory_order_acquire);
+            uint64_t head = ring.head.load(std::memory_order_relaxed);
+            uint64_t tail = ring.tail.load(std::memory_order_acquire);
+            for (uint64_t i = head; i < tail; ++i) batch.push_back(ring.records[i % Ring::CAPACITY]);
+            ring.head.store(tail, std::memory_order_release);
+            if (retired) {
+                it = rings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    uint64_t lost = dropped.load(std::memory_order_relaxed);
+    if (batch.empty() && lost == reported_dropped) return;
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const Record& a, const Record& b) { return a.time_ns < b.time_ns; });
+
+    out_buffer.clear();
+    err_buffer.clear();
+    for (const Record& record : batch) {
+        std::string& out = record.level >= LogLevel::Warn ? err_buffer : out_buffer;
+        appendTime(out, record.time_ns);
+        out += '[';
+        out += logLevelName(record.level);
+        out += "] ";
+        size_t offset = 0;
+        for (const char* c = record.format; *c != '\0'; ++c) {
+            if (c[0] == '{' && c[1] == '}') {
+                size_t taken = appendArgument(out, record.payload + offset, record.size - offset);
+                if (taken == 0) out += "{}";
+                offset += taken;
+                ++c;
+            } else {
+                out += *c;
+            }
+        }
+        out += '\n';
+    }
+    if (lost != reported_dropped) {
+        char buffer[96];
+        std::snprintf(buffer, sizeof(buffer), "[WARN] %llu log records dropped: logging faster than it drains\n",
+                      static_cast<unsigned long long>(lost - reported_dropped));
+        err_buffer += buffer;
+        reported_dropped = lost;
+    }
+
+    if (!out_buffer.empty()) {
+        std::fwrite(out_buffer.data(), 1, out_buffer.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err_buffer.empty()) {
+        std::fwrite(err_buffer.data(), 1, err_buffer.size(), stderr);
+        std::fflush(stderr);
+    }
+}
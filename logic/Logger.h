@@ -0,0 +1,183 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Fatal, Off };
+
+/**
+ * @brief Parses "debug", "info", "warn", "error", "fatal" or "off", in any case.
+ */
+bool parseLogLevel(const std::string& name, LogLevel& level);
+const char* logLevelName(LogLevel level);
+
+/**
+ * @class LogEncoder
+ * @brief Packs log arguments into a record's payload as tagged binary values.
+ *
+ * Strings longer than the space left are truncated.
+ */
+class LogEncoder {
+public:
+    enum Tag : uint8_t { Signed, Unsigned, Double, Bool, Text };
+
+    LogEncoder(uint8_t* buffer, size_t capacity) : out(buffer), capacity(capacity) {}
+
+    void add(bool value) { put(Bool, &value, 1); }
+    void add(double value) { put(Double, &value, sizeof(value)); }
+    void add(const char* value) { add(std::string_view(value != nullptr ? value : "(null)")); }
+    void add(const std::string& value) { add(std::string_view(value)); }
+    void add(std::string_view value);
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    void add(T value) {
+        int64_t wide = value;
+        put(Signed, &wide, sizeof(wide));
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, int>::type = 0>
+    void add(T value) {
+        uint64_t wide = value;
+        put(Unsigned, &wide, sizeof(wide));
+    }
+
+    size_t size() const { return used; }
+
+private:
+    void put(Tag tag, const void* data, size_t length) {
+        if (used + 1 + length > capacity) return;
+        out[used++] = tag;
+        std::memcpy(out + used, data, length);
+        used += length;
+    }
+
+    uint8_t* out;
+    size_t capacity;
+    size_t used = 0;
+};
+
+/**
+ * @class Logger
+ * @brief Asynchronous logger with a lock-free ring buffer per thread.
+ *
+ * A call below the current level returns after one relaxed load. Otherwise
+ * the caller writes a fixed-size binary record (timestamp, level, pointer to
+ * the format string and the encoded arguments) into its own thread's ring
+ * and publishes it with one release store; nothing is formatted or locked.
+ * A background thread collects records from every ring, orders them by
+ * time, formats them and writes them out in one go: Debug and Info to
+ * stdout, the rest to stderr. When a ring is full the record is dropped and
+ * counted rather than blocking the caller.
+ *
+ * Formats must be string literals: they are stored by pointer. Each "{}" is
+ * replaced by the next argument.
+ */
+class Logger {
+public:
+    static Logger& global();
+
+    Logger();
+
+    /**
+     * @brief Writes out everything logged so far, then stops the drain thread.
+     */
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void setLevel(LogLevel level) { min_level.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return min_level.load(std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= min_level.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    void log(LogLevel level, const char* format, const Args&... args) {
+        if (!enabled(level)) return;
+        Ring& ring = localRing();
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        if (tail - ring.head.load(std::memory_order_acquire) >= Ring::CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record& record = ring.records[tail % Ring::CAPACITY];
+        record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        record.format = format;
+        record.level = level;
+        LogEncoder encoder(record.payload, sizeof(record.payload));
+        (encoder.add(args), ...);
+        record.size = static_cast<uint8_t>(encoder.size());
+        ring.tail.store(tail + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Writes out every record logged before the call.
+     */
+    void flush();
+
+    // Records lost to full rings since startup.
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    static void debug(const char* format, const Args&... args) { global().log(LogLevel::Debug, format, args...); }
+    template <typename... Args>
+    static void info(const char* format, const Args&... args) { global().log(LogLevel::Info, format, args...); }
+    template <typename... Args>
+    static void warn(const char* format, const Args&... args) { global().log(LogLevel::Warn, format, args...); }
+    template <typename... Args>
+    static void error(const char* format, const Args&... args) { global().log(LogLevel::Error, format, args...); }
+    template <typename... Args>
+    static void fatal(const char* format, const Args&... args) { global().log(LogLevel::Fatal, format, args...); }
+
+private:
+    struct Record {
+        int64_t time_ns;
+        const char* format;
+        LogLevel level;
+        uint8_t size;
+        uint8_t payload[238];
+    };
+    static_assert(sizeof(Record) == 256, "log record must be 256 bytes");
+
+    // Single-producer (the owning thread), single-consumer (the drain thread).
+    struct Ring {
+        static constexpr uint64_t CAPACITY = 1024;
+        Record records[CAPACITY];
+        alignas(64) std::atomic<uint64_t> head{0}; // next record to drain
+        alignas(64) std::atomic<uint64_t> tail{0}; // next record to fill
+        std::atomic<bool> retired{false};          // owning thread has exited
+    };
+
+    Ring& localRing();
+    void run();
+    void drain();
+
+    std::atomic<LogLevel> min_level{LogLevel::Info};
+    std::atomic<uint64_t> dropped{0};
+    uint64_t reported_dropped = 0; // drain only
+
+    std::mutex rings_mtx;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::mutex drain_mtx;
+    std::vector<Record> batch; // drain_mtx held
+    std::string out_buffer;    // drain_mtx held
+    std::string err_buffer;    // drain_mtx held
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif // LOGGER_H
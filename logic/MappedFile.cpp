@@ -0,0 +1,160 @@
+#include "MappedFile.h"
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::fail(const std::string& what) {
+#ifdef _WIN32
+    last_error = what + " (error " + std::to_string(GetLastError()) + ")";
+#else
+    last_error = what + ": " + std::strerror(errno);
+#endif
+    return false;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, size_t min_size, bool read_only_mode) {
+    close();
+    read_only = read_only_mode;
+    HANDLE handle = CreateFileA(path.c_str(), read_only ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ, nullptr, read_only ? OPEN_EXISTING : OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return fail("Cannot open " + path);
+    file = handle;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) return fail("Cannot stat " + path);
+    length = static_cast<size_t>(size.QuadPart);
+    if (!read_only && length < min_size) return resize(min_size);
+    return map();
+}
+
+bool MappedFile::resize(size_t new_size) {
+    unmap();
+    LARGE_INTEGER size;
+    size.QuadPart = static_cast<LONGLONG>(new_size);
+    if (!SetFilePointerEx(static_cast<HANDLE>(file), size, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(static_cast<HANDLE>(file))) {
+        return fail("Cannot resize mapped file");
+    }
+    length = new_size;
+    return map();
+}
+
+bool MappedFile::map() {
+    if (length == 0) return true;
+    HANDLE handle = CreateFileMappingA(static_cast<HANDLE>(file), nullptr,
+                                       read_only ? PAGE_READONLY : PAGE_READWRITE, 0, 0, nullptr);
+    if (handle == nullptr) return fail("Cannot create file mapping");
+    mapping = handle;
+    void* view = MapViewOfFile(handle, read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, length);
+    if (view == nullptr) return fail("Cannot map file");
+    base = static_cast<uint8_t*>(view);
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (base != nullptr) UnmapViewOfFile(base);
+    if (mapping != nullptr) CloseHandle(static_cast<HANDLE>(mapping));
+    base = nullptr;
+    mapping = nullptr;
+}
+
+bool MappedFile::flush(size_t offset, size_t bytes) {
+    if (base == nullptr || bytes == 0) return true;
+    if (!FlushViewOfFile(base + offset, bytes) || !FlushFileBuffers(static_cast<HANDLE>(file))) {
+        return fail("Cannot flush mapped file");
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    unmap();
+    if (file != nullptr) CloseHandle(static_cast<HANDLE>(file));
+    file = nullptr;
+    length = 0;
+}
+
+bool MappedFile::replace(const std::string& from, const std::string& to, std::string& error) {
+    if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        error = "Cannot rename " + from + " to " + to + " (error " + std::to_string(GetLastError()) + ")";
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, size_t min_size, bool read_only_mode) {
+    close();
+    read_only = read_only_mode;
+    fd = ::open(path.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return fail("Cannot open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) return fail("Cannot stat " + path);
+    length = static_cast<size_t>(st.st_size);
+    if (!read_only && length < min_size) return resize(min_size);
+    return map();
+}
+
+bool MappedFile::resize(size_t new_size) {
+    unmap();
+    if (ftruncate(fd, static_cast<off_t>(new_size)) != 0) return fail("Cannot resize mapped file");
+    length = new_size;
+    return map();
+}
+
+bool MappedFile::map() {
+    if (length == 0) return true;
+    int prot = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* addr = mmap(nullptr, length, prot, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return fail("Cannot map file");
+    base = static_cast<uint8_t*>(addr);
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (base != nullptr) munmap(base, length);
+    base = nullptr;
+}
+
+bool MappedFile::flush(size_t offset, size_t bytes) {
+    if (base == nullptr || bytes == 0) return true;
+    // msync needs a page-aligned start address.
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset / page * page;
+    if (msync(base + start, offset + bytes - start, MS_SYNC) != 0) return fail("Cannot flush mapped file");
+    return true;
+}
+
+void MappedFile::close() {
+    unmap();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    length = 0;
+}
+
+bool MappedFile::replace(const std::string& from, const std::string& to, std::string& error) {
+    if (std::rename(from.c_str(), to.c_str()) != 0) {
+        error = "Cannot rename " + from + " to " + to + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+#endif
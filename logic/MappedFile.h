@@ -0,0 +1,71 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class MappedFile
+ * @brief A file mapped read-write into memory, growable in place.
+ *
+ * Thin wrapper over mmap on POSIX and file mappings on Windows. Pointers
+ * into the mapping are invalidated by resize() and close().
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Opens (creating if needed) and maps a file.
+     * @param min_size The file is extended with zeros to at least this size.
+     * @param read_only Maps the file read-only and never extends it.
+     * @return false on failure; error() describes it.
+     */
+    bool open(const std::string& path, size_t min_size, bool read_only = false);
+
+    /**
+     * @brief Grows or shrinks the file and remaps it.
+     */
+    bool resize(size_t new_size);
+
+    /**
+     * @brief Writes dirty pages in [offset, offset + length) to disk and waits for them.
+     */
+    bool flush(size_t offset, size_t length);
+
+    void close();
+
+    /**
+     * @brief Renames @p from over @p to, replacing it in one step. Neither
+     *        file may be open in this process on Windows.
+     */
+    static bool replace(const std::string& from, const std::string& to, std::string& error);
+
+    bool isOpen() const { return base != nullptr; }
+    uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    const std::string& error() const { return last_error; }
+
+private:
+    bool map();
+    void unmap();
+    bool fail(const std::string& what);
+
+    uint8_t* base = nullptr;
+    size_t length = 0;
+    bool read_only = false;
+    std::string last_error;
+#ifdef _WIN32
+    void* file = nullptr;    // HANDLE
+    void* mapping = nullptr; // HANDLE
+#else
+    int fd = -1;
+#endif
+};
+
+#endif // MAPPEDFILE_H
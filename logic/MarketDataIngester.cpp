@@ -0,0 +1,344 @@
+#include "MarketDataIngester.h"
+#include "Logger.h"
+#include "sqlite3.h"
+#include <fstream>
+#include <array>
+#include <cstdlib>
+
+namespace {
+
+constexpr size_t CHUNK_ROWS = 50000;
+
+// Optional Stock fundamentals, in Stock table column order.
+const std::array<const char*, 9> FUNDAMENTAL_COLUMNS = {
+    "MarketCap", "AvgVolume", "DividendYield", "PERatio", "FiftyTwoWeekLow",
+    "FiftyTwoWeekHigh", "DayLow", "DayHigh", "PreviousClose"
+};
+// MarketCap and AvgVolume are INTEGER columns.
+constexpr size_t INTEGER_FUNDAMENTALS = 2;
+
+// Splits one CSV record. Handles quoted fields with embedded commas and "" escapes.
+void splitCsvLine(const std::string& line, std::vector<std::string>& fields) {
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+}
+
+bool parseDouble(const std::string& text, double& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return *end == '\0';
+}
+
+bool parseInt64(const std::string& text, int64_t& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    value = std::strtoll(text.c_str(), &end, 10);
+    if (*end == '\0') return true;
+    // Accept "1.5e6"-style volumes exported as floats.
+    double d;
+    if (!parseDouble(text, d)) return false;
+    value = static_cast<int64_t>(d);
+    return true;
+}
+
+const std::string* column(const std::vector<std::string>& fields, int index) {
+    if (index < 0 || static_cast<size_t>(index) >= fields.size()) return nullptr;
+    return &fields[index];
+}
+
+} // namespace
+
+struct MarketDataIngester::Row {
+    SymbolId symbol = 0;
+    std::string company; // empty if not given
+    std::string timestamp; // empty means now
+    double price = 0;
+    int64_t volume = 0;
+    bool has_volume = false;
+    std::array<double, FUNDAMENTAL_COLUMNS.size()> fundamentals{};
+    uint32_t fundamentals_mask = 0; // bit i set when fundamentals[i] is present
+};
+
+MarketDataIngester::MarketDataIngester(GroupCommitWriter& writer)
+    : writer(writer), worker(&MarketDataIngester::run, this) {}
+
+MarketDataIngester::~MarketDataIngester() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+int64_t MarketDataIngester::submit(const std::string& csv_path) {
+    int64_t job_id;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (pending.size() >= MAX_QUEUED_JOBS) return 0;
+        job_id = next_job_id++;
+        IngestJob& job = jobs[job_id];
+        job.id = job_id;
+        job.csv_path = csv_path;
+        job.status = "queued";
+        pending.push_back(job_id);
+    }
+    cv.notify_one();
+    return job_id;
+}
+
+bool MarketDataIngester::getJob(int64_t job_id, IngestJob& job) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = jobs.find(job_id);
+    if (it == jobs.end()) return false;
+    job = it->second;
+    return true;
+}
+
+void MarketDataIngester::setCompletionHandler(CompletionHandler handler) {
+    std::lock_guard<std::mutex> lock(mtx);
+    on_complete = std::move(handler);
+}
+
+void MarketDataIngester::updateJob(int64_t job_id, const std::function<void(IngestJob&)>& update) {
+    std::lock_guard<std::mutex> lock(mtx);
+    update(jobs[job_id]);
+}
+
+void MarketDataIngester::run() {
+    while (true) {
+        int64_t job_id;
+        std::string csv_path;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break;
+            job_id = pending.front();
+            pending.pop_front();
+            IngestJob& job = jobs[job_id];
+            job.status = "running";
+            csv_path = job.csv_path;
+        }
+
+        std::string error;
+        bool ok = ingest(job_id, csv_path, error);
+
+        IngestJob finished_job;
+        CompletionHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            IngestJob& job = jobs[job_id];
+            job.status = ok ? "completed" : "failed";
+            job.error = error;
+            finished_job = job;
+            handler = on_complete;
+            finished.push_back(job_id);
+            if (finished.size() > MAX_FINISHED_JOBS) {
+                jobs.erase(finished.front());
+                finished.pop_front();
+            }
+        }
+        if (ok) {
+            Logger::info("Ingest job {} loaded {} rows from {}", job_id, finished_job.rows, csv_path);
+            if (handler) handler(finished_job);
+        } else {
+            Logger::error("Ingest job {} failed: {}", job_id, error);
+        }
+    }
+}
+
+bool MarketDataIngester::ingest(int64_t job_id, const std::string& csv_path, std::string& error) {
+    std::ifstream file(csv_path);
+    if (!file) {
+        error = "Cannot open " + csv_path;
+        return false;
+    }
+
+    std::string line;
+    std::vector<std::string> fields;
+    if (!std::getline(file, line)) {
+        error = "Empty file";
+        return false;
+    }
+
+    // Map header names to column positions
+    splitCsvLine(line, fields);
+    auto indexOf = [&](const char* name) {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+    };
+    int symbol_col = indexOf("Symbol");
+    int price_col = indexOf("Price");
+    int volume_col = indexOf("Volume");
+    int timestamp_col = indexOf("Timestamp");
+    int company_col = indexOf("CompanyName");
+    std::array<int, FUNDAMENTAL_COLUMNS.size()> fundamental_cols;
+    for (size_t i = 0; i < FUNDAMENTAL_COLUMNS.size(); ++i) {
+        fundamental_cols[i] = indexOf(FUNDAMENTAL_COLUMNS[i]);
+    }
+    if (symbol_col < 0 || price_col < 0) {
+        error = "Header must name Symbol and Price columns";
+        return false;
+    }
+
+    // Double-buffered: `chunk` fills while `writing` is in the writer's queue.
+    std::vector<Row> chunk;
+    std::vector<Row> writing;
+    chunk.reserve(CHUNK_ROWS);
+    writing.reserve(CHUNK_ROWS);
+    std::future<bool> pending_write;
+    int64_t skipped = 0;
+
+    auto finishWrite = [&]() {
+        if (!pending_write.valid()) return true;
+        if (!pending_write.get()) {
+            // Ids cached during the rolled-back chunk may not exist.
+            stock_ids.clear();
+            error = "Failed to write market data chunk";
+            return false;
+        }
+        updateJob(job_id, [&](IngestJob& job) {
+            job.rows += writing.size();
+            job.skipped = skipped;
+        });
+        writing.clear();
+        return true;
+    };
+    auto flush = [&]() {
+        if (!finishWrite()) return false;
+        writing.swap(chunk);
+        pending_write = writeChunk(writing);
+        return true;
+    };
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line == "\r") continue;
+        splitCsvLine(line, fields);
+
+        Row row;
+        const std::string* symbol = column(fields, symbol_col);
+        const std::string* price = column(fields, price_col);
+        if (symbol == nullptr || symbol->empty() || price == nullptr || !parseDouble(*price, row.price)) {
+            ++skipped;
+            continue;
+        }
+        row.symbol = SymbolTable::global().intern(*symbol);
+        if (const std::string* v = column(fields, volume_col)) row.has_volume = parseInt64(*v, row.volume);
+        if (const std::string* t = column(fields, timestamp_col)) row.timestamp = *t;
+        if (const std::string* c = column(fields, company_col)) row.company = *c;
+        for (size_t i = 0; i < FUNDAMENTAL_COLUMNS.size(); ++i) {
+            const std::string* f = column(fields, fundamental_cols[i]);
+            if (f != nullptr && parseDouble(*f, row.fundamentals[i])) {
+                row.fundamentals_mask |= 1u << i;
+            }
+        }
+        chunk.push_back(std::move(row));
+
+        if (chunk.size() == CHUNK_ROWS && !flush()) return false;
+    }
+    if (!chunk.empty() && !flush()) return false;
+    if (!finishWrite()) return false;
+
+    updateJob(job_id, [&](IngestJob& job) { job.skipped = skipped; });
+    return true;
+}
+
+std::future<bool> MarketDataIngester::writeChunk(const std::vector<Row>& chunk) {
+    const char* stock_sql = R"SQL(
+        INSERT INTO Stock (
+            Symbol, CompanyName, MarketCap, AvgVolume,
+            DividendYield, PERatio, FiftyTwoWeekLow,
+            FiftyTwoWeekHigh, DayLow, DayHigh, PreviousClose
+        ) VALUES (?1, COALESCE(?2, ?1), ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11)
+        ON CONFLICT (Symbol) DO UPDATE SET
+            CompanyName = COALESCE(?2, CompanyName),
+            MarketCap = COALESCE(?3, MarketCap),
+            AvgVolume = COALESCE(?4, AvgVolume),
+            DividendYield = COALESCE(?5, DividendYield),
+            PERatio = COALESCE(?6, PERatio),
+            FiftyTwoWeekLow = COALESCE(?7, FiftyTwoWeekLow),
+            FiftyTwoWeekHigh = COALESCE(?8, FiftyTwoWeekHigh),
+            DayLow = COALESCE(?9, DayLow),
+            DayHigh = COALESCE(?10, DayHigh),
+            PreviousClose = COALESCE(?11, PreviousClose);
+    )SQL";
+    const char* id_sql = "SELECT StockID FROM Stock WHERE Symbol = ?;";
+    const char* quote_sql = R"SQL(
+        INSERT INTO MarketData (StockID, Price, Volume, Timestamp)
+        VALUES (?, ?, ?, COALESCE(?, CURRENT_TIMESTAMP));
+    )SQL";
+
+    return writer.submit([this, &chunk, stock_sql, id_sql, quote_sql](Connection& conn) {
+        for (const Row& row : chunk) {
+            const std::string& symbol = SymbolTable::global().name(row.symbol);
+            if (row.symbol >= stock_ids.size()) {
+                stock_ids.resize(row.symbol + 1, 0);
+            }
+            int64_t& stock_id = stock_ids[row.symbol];
+
+            // New symbols and rows carrying fundamentals go through the Stock upsert.
+            if (stock_id == 0 || row.fundamentals_mask != 0 || !row.company.empty()) {
+                Statement stmt(conn.prepare(stock_sql));
+                if (!stmt) return false;
+                sqlite3_bind_text(stmt.get(), 1, symbol.c_str(), -1, SQLITE_STATIC);
+                if (!row.company.empty()) {
+                    sqlite3_bind_text(stmt.get(), 2, row.company.c_str(), -1, SQLITE_STATIC);
+                }
+                for (size_t i = 0; i < FUNDAMENTAL_COLUMNS.size(); ++i) {
+                    if ((row.fundamentals_mask & (1u << i)) == 0) continue;
+                    int param = static_cast<int>(i) + 3;
+                    if (i < INTEGER_FUNDAMENTALS) {
+                        sqlite3_bind_int64(stmt.get(), param, static_cast<int64_t>(row.fundamentals[i]));
+                    } else {
+                        sqlite3_bind_double(stmt.get(), param, row.fundamentals[i]);
+                    }
+                }
+                if (sqlite3_step(stmt.get()) != SQLITE_DONE) return false;
+            }
+
+            if (stock_id == 0) {
+                Statement stmt(conn.prepare(id_sql));
+                if (!stmt) return false;
+                sqlite3_bind_text(stmt.get(), 1, symbol.c_str(), -1, SQLITE_STATIC);
+                if (sqlite3_step(stmt.get()) != SQLITE_ROW) return false;
+                stock_id = sqlite3_column_int64(stmt.get(), 0);
+            }
+
+            Statement stmt(conn.prepare(quote_sql));
+            if (!stmt) return false;
+            sqlite3_bind_int64(stmt.get(), 1, stock_id);
+            sqlite3_bind_double(stmt.get(), 2, row.price);
+            if (row.has_volume) sqlite3_bind_int64(stmt.get(), 3, row.volume);
+            if (!row.timestamp.empty()) {
+                sqlite3_bind_text(stmt.get(), 4, row.timestamp.c_str(), -1, SQLITE_STATIC);
+            }
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE) return false;
+        }
+        return true;
+    }, true);
+}
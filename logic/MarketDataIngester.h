@@ -0,0 +1,99 @@
+#ifndef MARKETDATAINGESTER_H
+#define MARKETDATAINGESTER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
+#include <cstdint>
+#include "GroupCommitWriter.h"
+#include "SymbolTable.h"
+
+/**
+ * @struct IngestJob
+ * @brief Status of one CSV ingest request.
+ */
+struct IngestJob {
+    int64_t id = 0;
+    std::string csv_path;
+    std::string status; // queued, running, completed, failed
+    int64_t rows = 0;   // MarketData rows written so far
+    int64_t skipped = 0; // malformed rows ignored
+    std::string error;
+};
+
+/**
+ * @class MarketDataIngester
+ * @brief Loads quote CSV files into Stock and MarketData on a background thread.
+ *
+ * The file must start with a header row naming its columns. Symbol and Price
+ * are required; Volume, Timestamp, CompanyName and the Stock fundamentals
+ * columns (MarketCap, AvgVolume, DividendYield, PERatio, FiftyTwoWeekLow,
+ * FiftyTwoWeekHigh, DayLow, DayHigh, PreviousClose) are optional. Rows are
+ * parsed in a streaming pass and written in large bulk chunks through the
+ * group-commit writer, so ingest never competes with trades for the write lock.
+ * The next chunk is parsed while the previous one is being written.
+ */
+class MarketDataIngester {
+public:
+    using CompletionHandler = std::function<void(const IngestJob&)>;
+
+    explicit MarketDataIngester(GroupCommitWriter& writer);
+
+    /**
+     * @brief Finishes queued jobs, then stops the ingest thread.
+     */
+    ~MarketDataIngester();
+
+    MarketDataIngester(const MarketDataIngester&) = delete;
+    MarketDataIngester& operator=(const MarketDataIngester&) = delete;
+
+    /**
+     * @brief Queues a CSV file for ingest.
+     * @return The job id, or 0 if MAX_QUEUED_JOBS are already waiting.
+     */
+    int64_t submit(const std::string& csv_path);
+
+    /**
+     * @brief Looks up a job by id.
+     * @return false if the id is unknown.
+     */
+    bool getJob(int64_t job_id, IngestJob& job);
+
+    static constexpr size_t MAX_QUEUED_JOBS = 16;
+    static constexpr size_t MAX_FINISHED_JOBS = 256; // older ones are forgotten
+
+    /**
+     * @brief Sets a callback run on the ingest thread after each successful job.
+     */
+    void setCompletionHandler(CompletionHandler handler);
+
+private:
+    struct Row;
+
+    void run();
+    bool ingest(int64_t job_id, const std::string& csv_path, std::string& error);
+    std::future<bool> writeChunk(const std::vector<Row>& chunk);
+    void updateJob(int64_t job_id, const std::function<void(IngestJob&)>& update);
+
+    GroupCommitWriter& writer;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<int64_t> pending;
+    std::deque<int64_t> finished; // oldest first
+    std::map<int64_t, IngestJob> jobs;
+    int64_t next_job_id = 1;
+    bool stopping = false;
+    CompletionHandler on_complete;
+    // SymbolId -> StockID, 0 if not looked up yet; used only by the ingest
+    // thread and the writer work it waits on
+    std::vector<int64_t> stock_ids;
+    std::thread worker;
+};
+
+#endif // MARKETDATAINGESTER_H
@@ -0,0 +1,107 @@
+#include "MatchingEngine.h"
+
+OrderBook& MatchingEngine::bookFor(SymbolId symbol) {
+    if (symbol >= books.size()) {
+        books.resize(symbol + 1);
+    }
+    if (!books[symbol]) {
+        books[symbol] = std::make_unique<OrderBook>(symbol, pool);
+    }
+    return *books[symbol];
+}
+
+bool MatchingEngine::submit(const OrderRequest& request, std::vector<Fill>& fills, std::string& error) {
+    if (request.quantity <= 0) {
+        error = "Quantity must be positive.";
+        return false;
+    }
+    if (request.type == OrderType::Limit && request.limit_price <= Money()) {
+        error = "Limit orders need a positive price.";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    OrderBook& book = bookFor(request.symbol);
+
+    bool marketable = false;
+    if (book.hasLastPrice()) {
+        Money last = Money::fromMicros(book.getLastPrice());
+        marketable = request.type == OrderType::Market
+            || (request.side == Side::Buy && request.limit_price >= last)
+            || (request.side == Side::Sell && request.limit_price <= last);
+    } else if (request.type == OrderType::Market) {
+        error = "No market price available for " + SymbolTable::global().name(request.symbol) + ".";
+        return false;
+    }
+
+    if (marketable) {
+        fills.push_back({request.order_id, request.user_id, request.symbol, request.side,
+                         request.quantity, Money::fromMicros(book.getLastPrice()), 0,
+                         request.type == OrderType::Limit ? request.limit_price : Money()});
+        return true;
+    }
+
+    resting[request.order_id] = book.add(request);
+    return true;
+}
+
+bool MatchingEngine::cancel(int64_t order_id, int user_id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = resting.find(order_id);
+    if (it == resting.end() || it->second->user_id != user_id) {
+        return false;
+    }
+    it->second->book->cancel(it->second);
+    resting.erase(it);
+    return true;
+}
+
+void MatchingEngine::onMarketData(SymbolId symbol, Money price, int64_t volume, std::vector<Fill>& fills) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t first = fills.size();
+    bookFor(symbol).match(price.getMicros(), volume, fills);
+    for (size_t i = first; i < fills.size(); ++i) {
+        if (fills[i].remaining == 0) {
+            resting.erase(fills[i].order_id);
+        }
+    }
+}
+
+void MatchingEngine::restore(const std::vector<Fill>& fills) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const Fill& fill : fills) {
+        auto it = resting.find(fill.order_id);
+        if (it != resting.end()) {
+            it->second->book->restore(it->second, fill.quantity);
+        } else if (fill.remaining == 0 && fill.limit_price > Money()) {
+            // The fill took the whole order off the book (or it never rested)
+            OrderRequest request;
+            request.order_id = fill.order_id;
+            request.user_id = fill.user_id;
+            request.symbol = fill.symbol;
+            request.side = fill.side;
+            request.quantity = fill.quantity;
+            request.limit_price = fill.limit_price;
+            resting[fill.order_id] = bookFor(fill.symbol).add(request);
+        }
+    }
+}
+
+void MatchingEngine::setLastPrice(SymbolId symbol, Money price) {
+    std::lock_guard<std::mutex> lock(mtx);
+    bookFor(symbol).setLastPrice(price.getMicros());
+}
+
+bool MatchingEngine::getLastPrice(SymbolId symbol, Money& price) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (symbol >= books.size() || !books[symbol] || !books[symbol]->hasLastPrice()) {
+        return false;
+    }
+    price = Money::fromMicros(books[symbol]->getLastPrice());
+    return true;
+}
+
+size_t MatchingEngine::restingOrderCount() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return resting.size();
+}
@@ -0,0 +1,79 @@
+#ifndef MATCHINGENGINE_H
+#define MATCHINGENGINE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "OrderBook.h"
+
+/**
+ * @class MatchingEngine
+ * @brief Owns one OrderBook per symbol and routes orders, cancels and prices to them.
+ *
+ * Market orders and marketable limit orders fill immediately at the symbol's
+ * last traded price. Other limit orders rest until a market data price crosses
+ * them. Fills are appended to a caller-supplied vector so persistence can
+ * happen after the engine lock is released. All methods are thread-safe.
+ */
+class MatchingEngine {
+public:
+    MatchingEngine() = default;
+
+    MatchingEngine(const MatchingEngine&) = delete;
+    MatchingEngine& operator=(const MatchingEngine&) = delete;
+
+    /**
+     * @brief Accepts a new order.
+     * @param request The order; order_id must be unique (the OrderTable id).
+     * @param fills Receives any immediate executions.
+     * @param error Set to the reason when the order is rejected.
+     * @return false if the order was rejected.
+     */
+    bool submit(const OrderRequest& request, std::vector<Fill>& fills, std::string& error);
+
+    /**
+     * @brief Cancels a resting order owned by @p user_id.
+     * @return false if no such resting order exists for that user.
+     */
+    bool cancel(int64_t order_id, int user_id);
+
+    /**
+     * @brief Records a traded price for a symbol and fills every order it crosses.
+     * @param volume Shares available at this price; 0 means unlimited.
+     */
+    void onMarketData(SymbolId symbol, Money price, int64_t volume, std::vector<Fill>& fills);
+
+    /**
+     * @brief Undoes fills that could not be saved: their shares go back to
+     *        the orders they came from, which rest on the book again. Market
+     *        orders are not put back.
+     */
+    void restore(const std::vector<Fill>& fills);
+
+    /**
+     * @brief Records a price that resting orders were already matched against.
+     */
+    void setLastPrice(SymbolId symbol, Money price);
+
+    /**
+     * @brief Gets the last traded price for a symbol.
+     * @return false if no price has been seen for the symbol yet.
+     */
+    bool getLastPrice(SymbolId symbol, Money& price);
+
+    size_t restingOrderCount();
+
+private:
+    OrderBook& bookFor(SymbolId symbol);
+
+    std::mutex mtx;
+    // Declared before the books so it outlives them; books return nodes on destruction.
+    OrderPool pool;
+    // Indexed by SymbolId; null until the symbol first sees an order or a price.
+    std::vector<std::unique_ptr<OrderBook>> books;
+    std::unordered_map<int64_t, Order*> resting;
+};
+
+#endif // MATCHINGENGINE_H
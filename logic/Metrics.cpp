@@ -0,0 +1,177 @@
+#include "Metrics.h"
+#include <cstdio>
+#include <algorithm>
+
+namespace {
+
+// Bucket boundaries of the exported Prometheus histograms, in nanoseconds.
+constexpr uint64_t EXPORT_BOUNDS[] = {
+    25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000, 2500000000, 5000000000, 10000000000,
+};
+
+constexpr double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+void appendHeader(std::string& out, const std::string& name, const std::string& help, const char* type) {
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+void appendSample(std::string& out, const std::string& name, const std::string& labels, double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    out += name;
+    if (!labels.empty()) out += "{" + labels + "}";
+    out += " ";
+    out += buffer;
+    out += "\n";
+}
+
+std::string withLabel(const std::string& labels, const std::string& extra) {
+    return labels.empty() ? extra : labels + "," + extra;
+}
+
+std::string seconds(uint64_t nanos) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", nanos / 1e9);
+    return buffer;
+}
+
+} // namespace
+
+size_t LatencyHistogram::bucketFor(uint64_t nanos) {
+    if (nanos < SUB_BUCKETS) return static_cast<size_t>(nanos);
+    if (nanos >= (uint64_t(1) << MAX_BITS)) nanos = (uint64_t(1) << MAX_BITS) - 1;
+    unsigned msb = 63;
+    while ((nanos >> msb) == 0) --msb;
+    unsigned shift = msb - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((nanos >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    size_t group = bucket / SUB_BUCKETS;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    if (group == 0) return sub;
+    unsigned shift = static_cast<unsigned>(group - 1);
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    counts[bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::snapshot(std::vector<uint64_t>& out, uint64_t& sum_nanos) const {
+    out.resize(BUCKETS);
+    for (size_t i = 0; i < BUCKETS; ++i) out[i] = counts[i].load(std::memory_order_relaxed);
+    sum_nanos = sum.load(std::memory_order_relaxed);
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+LatencyHistogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& series : histograms) {
+        if (series.name == name && series.labels == labels) return series.value;
+    }
+    histograms.emplace_back();
+    histograms.back().name = name;
+    histograms.back().help = help;
+    histograms.back().labels = labels;
+    return histograms.back().value;
+}
+
+std::atomic<uint64_t>& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& series : counters) {
+        if (series.name == name && series.labels == labels) return series.value;
+    }
+    counters.emplace_back();
+    counters.back().name = name;
+    counters.back().help = help;
+    counters.back().labels = labels;
+    return counters.back().value;
+}
+
+void Metrics::render(std::string& out) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // Series are grouped by name so each family gets one HELP/TYPE header.
+    std::vector<const std::string*> written;
+    auto firstOf = [&written](const std::string& name) {
+        for (const std::string* seen : written) {
+            if (*seen == name) return false;
+        }
+        written.push_back(&name);
+        return true;
+    };
+
+    std::vector<uint64_t> counts;
+    for (const auto& family : histograms) {
+        if (!firstOf(family.name)) continue;
+        const std::string summary_name = family.name.substr(0, family.name.rfind("_seconds")) + "_quantile_seconds";
+        std::string summaries;
+        appendHeader(out, family.name, family.help, "histogram");
+        appendHeader(summaries, summary_name, family.help + " (quantiles since startup)", "summary");
+
+        for (const auto& series : histograms) {
+            if (series.name != family.name) continue;
+            uint64_t sum_nanos;
+            series.value.snapshot(counts, sum_nanos);
+
+            uint64_t total = 0;
+            size_t bucket = 0;
+            for (uint64_t bound : EXPORT_BOUNDS) {
+                for (; bucket < counts.size() && LatencyHistogram::bucketUpperBound(bucket) <= bound; ++bucket) {
+                    total += counts[bucket];
+                }
+                appendSample(out, series.name + "_bucket", withLabel(series.labels, "le=\"" + seconds(bound) + "\""),
+                             static_cast<double>(total));
+            }
+            for (; bucket < counts.size(); ++bucket) total += counts[bucket];
+            appendSample(out, series.name + "_bucket", withLabel(series.labels, "le=\"+Inf\""), static_cast<double>(total));
+            appendSample(out, series.name + "_sum", series.labels, sum_nanos / 1e9);
+            appendSample(out, series.name + "_count", series.labels, static_cast<double>(total));
+
+            uint64_t seen = 0;
+            bucket = 0;
+            for (double quantile : QUANTILES) {
+                uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * total + 0.5));
+                while (bucket < counts.size() && (seen + counts[bucket] < rank || counts[bucket] == 0)) {
+                    seen += counts[bucket++];
+                }
+                uint64_t value = total == 0 || bucket == counts.size() ? 0 : LatencyHistogram::bucketUpperBound(bucket);
+                char label[32];
+                std::snprintf(label, sizeof(label), "quantile=\"%g\"", quantile);
+                appendSample(summaries, summary_name, withLabel(series.labels, label), value / 1e9);
+            }
+            appendSample(summaries, summary_name + "_sum", series.labels, sum_nanos / 1e9);
+            appendSample(summaries, summary_name + "_count", series.labels, static_cast<double>(total));
+        }
+        out += summaries;
+    }
+
+    for (const auto& family : counters) {
+        if (!firstOf(family.name)) continue;
+        appendHeader(out, family.name, family.help, "counter");
+        for (const auto& series : counters) {
+            if (series.name != family.name) continue;
+            appendSample(out, series.name, series.labels,
+                         static_cast<double>(series.value.load(std::memory_order_relaxed)));
+        }
+    }
+}
+
+void Metrics::writeCounter(std::string& out, const std::string& name, const std::string& help, uint64_t value) {
+    appendHeader(out, name, help, "counter");
+    appendSample(out, name, "", static_cast<double>(value));
+}
+
+void Metrics::writeGauge(std::string& out, const std::string& name, const std::string& help, double value) {
+    appendHeader(out, name, help, "gauge");
+    appendSample(out, name, "", value);
+}
@@ -0,0 +1,112 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * @brief Lock-free latency histogram with HDR-style log-linear buckets.
+ *
+ * Each power of two from 16 ns up to about 18 minutes is split into 16
+ * equal buckets, so any recorded value is known to within 6.25%. Recording
+ * is two relaxed atomic increments and needs no lock; readers see a
+ * consistent-enough view without stopping writers.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_BITS = 40; // values are clamped below 2^40 ns
+    static constexpr size_t BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t nanos);
+
+    void record(std::chrono::steady_clock::duration elapsed) {
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        record(static_cast<uint64_t>(nanos > 0 ? nanos : 0));
+    }
+
+    /**
+     * @brief Copies the bucket counts; @p sum_nanos gets the total of every value.
+     */
+    void snapshot(std::vector<uint64_t>& counts, uint64_t& sum_nanos) const;
+
+    static size_t bucketFor(uint64_t nanos);
+    // Largest value that falls into @p bucket.
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS] = {};
+    std::atomic<uint64_t> sum{0};
+};
+
+/**
+ * @class ScopedLatency
+ * @brief Records the time from construction to destruction into a histogram.
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { histogram.record(std::chrono::steady_clock::now() - start); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @class Metrics
+ * @brief Registry of counters and latency histograms, exported in the
+ *        Prometheus text format.
+ *
+ * Metrics are registered once, usually into a function-local static, and
+ * then updated without touching the registry. Values that already live
+ * elsewhere (cache hit counts and the like) are appended at scrape time with
+ * writeCounter() and writeGauge().
+ */
+class Metrics {
+public:
+    static Metrics& global();
+
+    /**
+     * @brief Returns the series @p name{@p labels}, creating it on first use.
+     * @param labels Prometheus label pairs without braces, e.g. route="/login".
+     */
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels);
+    std::atomic<uint64_t>& counter(const std::string& name, const std::string& help, const std::string& labels);
+
+    /**
+     * @brief Renders every registered series. Histograms are written as a
+     *        Prometheus histogram plus a summary of common quantiles.
+     */
+    void render(std::string& out);
+
+    static void writeCounter(std::string& out, const std::string& name, const std::string& help, uint64_t value);
+    static void writeGauge(std::string& out, const std::string& name, const std::string& help, double value);
+
+private:
+    template <typename T>
+    struct Series {
+        std::string name;
+        std::string help;
+        std::string labels;
+        T value;
+    };
+
+    std::mutex mtx;
+    // deque: references handed out stay valid as series are added
+    std::deque<Series<LatencyHistogram>> histograms;
+    std::deque<Series<std::atomic<uint64_t>>> counters;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,91 @@
+#include "Money.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 2^63 as a double; products at or beyond it do not fit an int64.
+constexpr double MICROS_LIMIT = 9223372036854775808.0;
+
+} // namespace
+
+Money Money::fromDouble(double value) {
+    Money money;
+    if (fromDouble(value, money)) return money;
+    if (std::isnan(value)) return Money();
+    return Money(value > 0 ? std::numeric_limits<int64_t>::max() : std::numeric_limits<int64_t>::min());
+}
+
+bool Money::fromDouble(double value, Money& money) {
+    double scaled = std::round(value * SCALE);
+    if (!std::isfinite(scaled) || scaled >= MICROS_LIMIT || scaled < -MICROS_LIMIT) return false;
+    money = Money(static_cast<int64_t>(scaled));
+    return true;
+}
+
+bool Money::multiply(Money amount, int64_t quantity, Money& product) {
+    int64_t micros;
+    if (__builtin_mul_overflow(amount.micros, quantity, &micros)) return false;
+    product = Money(micros);
+    return true;
+}
+
+bool Money::add(Money a, Money b, Money& sum) {
+    int64_t micros;
+    if (__builtin_add_overflow(a.micros, b.micros, &micros)) return false;
+    sum = Money(micros);
+    return true;
+}
+
+Money Money::saturatingAdd(Money a, Money b) {
+    int64_t micros;
+    if (__builtin_add_overflow(a.micros, b.micros, &micros)) {
+        micros = b.micros < 0 ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+    }
+    return Money(micros);
+}
+
+Money Money::saturatingSubtract(Money a, Money b) {
+    int64_t micros;
+    if (__builtin_sub_overflow(a.micros, b.micros, &micros)) {
+        micros = b.micros > 0 ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+    }
+    return Money(micros);
+}
+
+bool Money::parse(const std::string& text, Money& value) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i] == '-';
+        ++i;
+    }
+
+    const int64_t limit = std::numeric_limits<int64_t>::max() / SCALE;
+    int64_t units = 0;
+    size_t digits = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++digits) {
+        units = units * 10 + (text[i] - '0');
+        if (units > limit) return false;
+    }
+
+    int64_t fraction = 0;
+    int64_t place = SCALE;
+    if (i < text.size() && text[i] == '.') {
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++digits) {
+            place /= 10;
+            if (place == 0) return false; // more than six decimals
+            fraction += (text[i] - '0') * place;
+        }
+    }
+    if (i != text.size() || digits == 0) return false;
+    if (units > (std::numeric_limits<int64_t>::max() - fraction) / SCALE) return false;
+
+    int64_t micros = units * SCALE + fraction;
+    value = Money(negative ? -micros : micros);
+    return true;
+}
+
+double Money::toDouble() const {
+    return static_cast<double>(micros) / SCALE;
+}
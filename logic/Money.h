@@ -0,0 +1,82 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <string>
+#include <cstdint>
+
+/**
+ * @class Money
+ * @brief Exact fixed-point amount, stored as an integer number of micro-units.
+ *
+ * Cash balances, cost bases and prices are all Money, so sums over millions
+ * of trades never drift. Doubles appear only at the edges: JSON numbers and
+ * the REAL price columns shared with stockdb.py. Converting a decimal with up
+ * to six fractional digits through a double is exact in both directions.
+ */
+class Money {
+public:
+    static constexpr int64_t SCALE = 1000000;
+
+    constexpr Money() : micros(0) {}
+
+    static constexpr Money fromMicros(int64_t micros) { return Money(micros); }
+    static constexpr Money fromUnits(int64_t units) { return Money(units * SCALE); }
+
+    /**
+     * @brief Converts a double, rounding to the nearest micro-unit. NaN gives
+     *        zero and values beyond the range saturate.
+     */
+    static Money fromDouble(double value);
+
+    /**
+     * @brief Converts a double, rounding to the nearest micro-unit.
+     * @return false if the value is not finite or does not fit.
+     */
+    static bool fromDouble(double value, Money& money);
+
+    /**
+     * @brief Parses a plain decimal such as "-12.345" without going through a double.
+     * @return false if the text is not a decimal with at most six fractional digits.
+     */
+    static bool parse(const std::string& text, Money& value);
+
+    /**
+     * @brief Multiplies and adds without overflowing; trade amounts go through
+     *        these so an absurd price or quantity is refused, not wrapped.
+     * @return false if the result does not fit.
+     */
+    static bool multiply(Money amount, int64_t quantity, Money& product);
+    static bool add(Money a, Money b, Money& sum);
+
+    /**
+     * @brief Adds or subtracts, clamping to the representable range instead
+     *        of overflowing. For reported figures such as valuations, where a
+     *        capped value is better than one with the wrong sign.
+     */
+    static Money saturatingAdd(Money a, Money b);
+    static Money saturatingSubtract(Money a, Money b);
+
+    constexpr int64_t getMicros() const { return micros; }
+    double toDouble() const;
+
+    constexpr Money operator+(Money other) const { return Money(micros + other.micros); }
+    constexpr Money operator-(Money other) const { return Money(micros - other.micros); }
+    constexpr Money operator-() const { return Money(-micros); }
+    constexpr Money operator*(int64_t quantity) const { return Money(micros * quantity); }
+    Money& operator+=(Money other) { micros += other.micros; return *this; }
+    Money& operator-=(Money other) { micros -= other.micros; return *this; }
+
+    constexpr bool operator==(Money other) const { return micros == other.micros; }
+    constexpr bool operator!=(Money other) const { return micros != other.micros; }
+    constexpr bool operator<(Money other) const { return micros < other.micros; }
+    constexpr bool operator<=(Money other) const { return micros <= other.micros; }
+    constexpr bool operator>(Money other) const { return micros > other.micros; }
+    constexpr bool operator>=(Money other) const { return micros >= other.micros; }
+
+private:
+    explicit constexpr Money(int64_t micros) : micros(micros) {}
+
+    int64_t micros;
+};
+
+#endif // MONEY_H
@@ -0,0 +1,143 @@
+#include "OrderBook.h"
+
+// --- OrderPool ---
+
+Order* OrderPool::allocate() {
+    if (free_list == nullptr) {
+        chunks.emplace_back(new Order[CHUNK_SIZE]);
+        Order* chunk = chunks.back().get();
+        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            chunk[i].next = free_list;
+            free_list = &chunk[i];
+        }
+    }
+    Order* order = free_list;
+    free_list = order->next;
+    return order;
+}
+
+void OrderPool::release(Order* order) {
+    order->next = free_list;
+    free_list = order;
+}
+
+// --- OrderBook ---
+
+OrderBook::OrderBook(SymbolId symbol, OrderPool& pool) : symbol(symbol), pool(pool) {}
+
+OrderBook::~OrderBook() {
+    for (auto& entry : bids) {
+        for (Order* o = entry.second.head; o != nullptr;) {
+            Order* next = o->next;
+            pool.release(o);
+            o = next;
+        }
+    }
+    for (auto& entry : asks) {
+        for (Order* o = entry.second.head; o != nullptr;) {
+            Order* next = o->next;
+            pool.release(o);
+            o = next;
+        }
+    }
+}
+
+void OrderBook::setLastPrice(int64_t price) {
+    last_price = price;
+    has_last_price = true;
+}
+
+Order* OrderBook::add(const OrderRequest& request) {
+    Order* order = pool.allocate();
+    order->order_id = request.order_id;
+    order->user_id = request.user_id;
+    order->side = request.side;
+    order->quantity = request.quantity;
+    order->price = request.limit_price.getMicros();
+    order->book = this;
+    order->next = nullptr;
+
+    PriceLevel* level;
+    if (request.side == Side::Buy) {
+        level = &bids[order->price];
+    } else {
+        level = &asks[order->price];
+    }
+    level->price = order->price;
+
+    // Append to the tail so earlier orders at this price keep priority.
+    order->level = level;
+    order->prev = level->tail;
+    if (level->tail != nullptr) {
+        level->tail->next = order;
+    } else {
+        level->head = order;
+    }
+    level->tail = order;
+    level->total_quantity += order->quantity;
+    return order;
+}
+
+void OrderBook::unlink(Order* order) {
+    PriceLevel* level = order->level;
+    if (order->prev != nullptr) order->prev->next = order->next;
+    else level->head = order->next;
+    if (order->next != nullptr) order->next->prev = order->prev;
+    else level->tail = order->prev;
+    level->total_quantity -= order->quantity;
+
+    if (level->head == nullptr) {
+        if (order->side == Side::Buy) bids.erase(level->price);
+        else asks.erase(level->price);
+    }
+}
+
+void OrderBook::cancel(Order* order) {
+    unlink(order);
+    pool.release(order);
+}
+
+void OrderBook::restore(Order* order, int quantity) {
+    order->quantity += quantity;
+    order->level->total_quantity += quantity;
+}
+
+template <typename Levels>
+void OrderBook::fillLevels(Levels& levels, int64_t price, int64_t& volume_left, std::vector<Fill>& fills) {
+    // A level crosses unless the traded price is strictly better than it in the
+    // book's own ordering (above a bid, below an ask).
+    while (!levels.empty() && volume_left != 0 && !levels.key_comp()(price, levels.begin()->first)) {
+        PriceLevel& level = levels.begin()->second;
+        while (level.head != nullptr && volume_left != 0) {
+            Order* order = level.head;
+            int quantity = order->quantity;
+            if (volume_left > 0 && volume_left < quantity) {
+                quantity = static_cast<int>(volume_left);
+            }
+            if (volume_left > 0) volume_left -= quantity;
+
+            order->quantity -= quantity;
+            level.total_quantity -= quantity;
+            fills.push_back({order->order_id, order->user_id, symbol, order->side, quantity, Money::fromMicros(price), order->quantity,
+                              Money::fromMicros(order->price)});
+
+            if (order->quantity == 0) {
+                level.head = order->next;
+                if (level.head != nullptr) level.head->prev = nullptr;
+                else level.tail = nullptr;
+                pool.release(order);
+            }
+        }
+        if (level.head == nullptr) {
+            levels.erase(levels.begin());
+        }
+    }
+}
+
+void OrderBook::match(int64_t price, int64_t volume, std::vector<Fill>& fills) {
+    setLastPrice(price);
+    // Negative volume_left means no volume limit.
+    int64_t volume_left = volume > 0 ? volume : -1;
+    fillLevels(bids, price, volume_left, fills);
+    fillLevels(asks, price, volume_left, fills);
+}
@@ -0,0 +1,162 @@
+#ifndef ORDERBOOK_H
+#define ORDERBOOK_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include "SymbolTable.h"
+#include "Money.h"
+
+// Inside the books, prices are plain int64_t Money micro-units.
+
+enum class Side : uint8_t { Buy, Sell };
+enum class OrderType : uint8_t { Market, Limit };
+
+/**
+ * @struct OrderRequest
+ * @brief An order as submitted by a user (or reloaded from OrderTable).
+ */
+struct OrderRequest {
+    int64_t order_id = 0;
+    int user_id = 0;
+    SymbolId symbol = 0;
+    Side side = Side::Buy;
+    OrderType type = OrderType::Limit;
+    int quantity = 0;
+    Money limit_price; // ignored for market orders
+};
+
+/**
+ * @struct Fill
+ * @brief One execution against an order. remaining == 0 means the order is done.
+ */
+struct Fill {
+    int64_t order_id;
+    int user_id;
+    SymbolId symbol;
+    Side side;
+    int quantity;
+    Money price;
+    int remaining;
+    Money limit_price; // of the order; zero for market orders
+};
+
+struct PriceLevel;
+class OrderBook;
+
+/**
+ * @struct Order
+ * @brief A resting order. Orders at one price are linked intrusively in time order.
+ */
+struct Order {
+    int64_t order_id;
+    int user_id;
+    Side side;
+    int quantity; // remaining
+    int64_t price;
+    Order* prev;
+    Order* next;
+    PriceLevel* level;
+    OrderBook* book;
+};
+
+/**
+ * @struct PriceLevel
+ * @brief FIFO queue of resting orders at a single price.
+ */
+struct PriceLevel {
+    int64_t price = 0;
+    int64_t total_quantity = 0;
+    Order* head = nullptr;
+    Order* tail = nullptr;
+};
+
+/**
+ * @class OrderPool
+ * @brief Free-list allocator for Order nodes, grown in fixed-size chunks.
+ *
+ * Nodes are recycled rather than returned to the heap, so steady-state order
+ * flow performs no allocation.
+ */
+class OrderPool {
+public:
+    OrderPool() = default;
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    Order* allocate();
+    void release(Order* order);
+
+private:
+    static constexpr size_t CHUNK_SIZE = 4096;
+    std::vector<std::unique_ptr<Order[]>> chunks;
+    Order* free_list = nullptr;
+};
+
+/**
+ * @class OrderBook
+ * @brief Resting limit orders for one symbol, in price-time priority.
+ *
+ * Best bid and best ask are the first entries of their level maps, so reading
+ * them is O(1). Incoming market data prices are matched against the book:
+ * bids at or above the price and asks at or below it are filled at that price.
+ */
+class OrderBook {
+public:
+    OrderBook(SymbolId symbol, OrderPool& pool);
+    ~OrderBook();
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    /**
+     * @brief Places a limit order on the book.
+     * @return The resting order node.
+     */
+    Order* add(const OrderRequest& request);
+
+    /**
+     * @brief Removes a resting order and returns its node to the pool.
+     */
+    void cancel(Order* order);
+
+    /**
+     * @brief Gives a resting order back @p quantity shares, keeping its place in line.
+     */
+    void restore(Order* order, int quantity);
+
+    /**
+     * @brief Fills resting orders that cross a traded price, best price first.
+     * @param price The traded price in micro-units.
+     * @param volume Shares available at that price; 0 or less means unlimited.
+     * @param fills Receives one Fill per execution.
+     */
+    void match(int64_t price, int64_t volume, std::vector<Fill>& fills);
+
+    SymbolId getSymbol() const { return symbol; }
+    bool hasBid() const { return !bids.empty(); }
+    bool hasAsk() const { return !asks.empty(); }
+    int64_t bestBid() const { return bids.begin()->first; }
+    int64_t bestAsk() const { return asks.begin()->first; }
+
+    bool hasLastPrice() const { return has_last_price; }
+    int64_t getLastPrice() const { return last_price; }
+    void setLastPrice(int64_t price);
+
+private:
+    template <typename Levels>
+    void fillLevels(Levels& levels, int64_t price, int64_t& volume_left, std::vector<Fill>& fills);
+    void unlink(Order* order);
+
+    SymbolId symbol;
+    OrderPool& pool;
+    std::map<int64_t, PriceLevel, std::greater<int64_t>> bids;
+    std::map<int64_t, PriceLevel> asks;
+    int64_t last_price = 0;
+    bool has_last_price = false;
+};
+
+#endif // ORDERBOOK_H
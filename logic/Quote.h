@@ -0,0 +1,16 @@
+#ifndef QUOTE_H
+#define QUOTE_H
+
+#include <cstdint>
+#include "Money.h"
+#include "SymbolTable.h"
+
+// Latest traded price and volume for one symbol.
+struct Quote {
+    SymbolId symbol;
+    Money price;
+    int64_t volume;
+    int64_t id = 0; // MarketDataID of the row, increasing with every ingested quote
+};
+
+#endif // QUOTE_H
@@ -0,0 +1,82 @@
+#include "QuoteCache.h"
+#include "Money.h"
+#include <atomic>
+#include <cstdio>
+
+namespace {
+
+// FNV-1a, so the ETag is stable across restarts for identical data.
+uint64_t hashBody(const std::string& body) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void appendLittleEndian(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+// Writes the QuoteTable layout described in QuoteCache.h.
+void encodeQuoteTable(const nlohmann::json& stocks, std::string& out) {
+    const size_t SYMBOL_BYTES = 16;
+    out.reserve(8 + stocks.size() * (SYMBOL_BYTES + 16));
+    out += "PTQ1";
+    appendLittleEndian(out, stocks.size(), 4);
+    for (const auto& stock : stocks) {
+        auto symbol = stock.find("Symbol");
+        auto price = stock.find("Price");
+        auto volume = stock.find("Volume");
+        std::string name = symbol != stock.end() && symbol->is_string() ? symbol->get<std::string>() : "";
+        name.resize(SYMBOL_BYTES, '\0');
+        out += name;
+        Money money = price != stock.end() && price->is_number() ? Money::fromDouble(price->get<double>()) : Money();
+        appendLittleEndian(out, static_cast<uint64_t>(money.getMicros()), 8);
+        int64_t shares = volume != stock.end() && volume->is_number() ? volume->get<int64_t>() : 0;
+        appendLittleEndian(out, static_cast<uint64_t>(shares), 8);
+    }
+}
+
+} // namespace
+
+const std::string& QuoteSnapshot::encoded(Encoding encoding) const {
+    if (encoding == Encoding::Json) return body;
+    size_t index = static_cast<size_t>(encoding);
+    std::call_once(encode_once[index], [&]() {
+        nlohmann::json stocks = nlohmann::json::parse(body);
+        if (encoding == Encoding::QuoteTable) {
+            encodeQuoteTable(stocks, encodings[index]);
+        } else {
+            encodeDocument(stocks, encoding, encodings[index]);
+        }
+    });
+    return encodings[index];
+}
+
+std::shared_ptr<const QuoteSnapshot> QuoteCache::current() const {
+    return std::atomic_load(&snapshot);
+}
+
+std::shared_ptr<const QuoteSnapshot> QuoteCache::publish(std::string body) {
+    std::lock_guard<std::mutex> lock(publish_mtx);
+
+    auto next = std::make_shared<QuoteSnapshot>();
+    next->version = ++version;
+    // Every encoding is derived from the body, so one hash identifies them all.
+    uint64_t hash = hashBody(body);
+    for (size_t encoding = 0; encoding < ENCODING_COUNT; ++encoding) {
+        char etag[40];
+        std::snprintf(etag, sizeof(etag), "\"%016llx%s\"", static_cast<unsigned long long>(hash),
+                      etagSuffix(static_cast<Encoding>(encoding)));
+        next->etags[encoding] = etag;
+    }
+    next->body = std::move(body);
+
+    std::shared_ptr<const QuoteSnapshot> published = next;
+    std::atomic_store(&snapshot, published);
+    return published;
+}
@@ -0,0 +1,74 @@
+#ifndef QUOTECACHE_H
+#define QUOTECACHE_H
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "ResponseEncoding.h"
+
+/**
+ * @struct QuoteSnapshot
+ * @brief An immutable, pre-rendered /stocks response.
+ *
+ * The JSON body is rendered on publish. The other encodings are built from
+ * it the first time a client asks for them and then served until the next
+ * publish. The QuoteTable encoding is, all integers little-endian:
+ *
+ *   header, 8 bytes:   char magic[4] = "PTQ1", uint32 count
+ *   count records, 32 bytes each, in snapshot order:
+ *                      char symbol[16] (NUL-padded), int64 price in
+ *                      micro-units (Money), int64 volume
+ */
+struct QuoteSnapshot {
+    uint64_t version;
+    std::string body; // serialized JSON array served as-is
+    std::string etags[ENCODING_COUNT]; // quoted strong validators, one per encoding
+
+    /**
+     * @brief Returns the snapshot in @p encoding, encoding it on first use.
+     */
+    const std::string& encoded(Encoding encoding) const;
+    const std::string& etag(Encoding encoding = Encoding::Json) const {
+        return etags[static_cast<size_t>(encoding)];
+    }
+
+private:
+    mutable std::once_flag encode_once[ENCODING_COUNT];
+    mutable std::string encodings[ENCODING_COUNT]; // Json is left empty; body is used
+};
+
+/**
+ * @class QuoteCache
+ * @brief Read-mostly holder of the current QuoteSnapshot.
+ *
+ * Readers take a reference to the current snapshot with one atomic load and
+ * never block. Publishing builds a new snapshot off to the side and swaps it
+ * in atomically; readers still holding the old one keep it alive until they
+ * finish.
+ */
+class QuoteCache {
+public:
+    QuoteCache() = default;
+
+    QuoteCache(const QuoteCache&) = delete;
+    QuoteCache& operator=(const QuoteCache&) = delete;
+
+    /**
+     * @brief Returns the current snapshot, or nullptr if none has been published.
+     */
+    std::shared_ptr<const QuoteSnapshot> current() const;
+
+    /**
+     * @brief Publishes a new snapshot for the given serialized body.
+     * @return The snapshot now being served.
+     */
+    std::shared_ptr<const QuoteSnapshot> publish(std::string body);
+
+private:
+    std::shared_ptr<const QuoteSnapshot> snapshot;
+    std::mutex publish_mtx; // serializes writers only
+    uint64_t version = 0;
+};
+
+#endif // QUOTECACHE_H
@@ -0,0 +1,338 @@
+#include "QuoteStream.h"
+#include "JsonWriter.h"
+#include "SymbolTable.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+struct QuoteStream::Subscriber {
+    std::vector<bool> symbols; // by SymbolId; empty follows every symbol
+    int sock = -1;             // attached socket, or -1 when pulled with next()
+
+    std::mutex mtx; // guards the members below
+    std::condition_variable ready;
+    std::string queue;   // events not yet handed to the socket or next()
+    std::string sending; // attached only: the chunk being written
+    size_t sent = 0;
+    bool closed = false;
+
+    bool follows(SymbolId id) const { return symbols.empty() || (id < symbols.size() && symbols[id]); }
+};
+
+namespace {
+
+// Sent first: how long EventSource clients wait before reconnecting.
+const char GREETING[] = "retry: 3000\n\n";
+const char KEEPALIVE[] = ":\n\n";
+
+void renderEvent(const Quote& quote, std::string& out) {
+    out.clear();
+    out += "event: quote\ndata: ";
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("\"symbol\":");
+    writer.value(SymbolTable::global().name(quote.symbol));
+    writer.key("\"price\":");
+    writer.value(quote.price);
+    writer.key("\"volume\":");
+    writer.value(quote.volume);
+    writer.endObject();
+    out += "\n\n";
+}
+
+} // namespace
+
+QuoteStream::QuoteStream(size_t queue_bytes, size_t max_subscribers)
+    : queue_bytes(queue_bytes), max_subscribers(max_subscribers) {
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // the wake fd; subscribers carry their Subscriber*
+    if (epoll_fd < 0 || wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0) {
+        Logger::error("Failed to create the quote stream event loop");
+    }
+    writer = std::thread(&QuoteStream::run, this);
+#endif
+}
+
+QuoteStream::~QuoteStream() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+        for (const auto& subscriber : subscribers) {
+            std::lock_guard<std::mutex> subscriber_lock(subscriber->mtx);
+            subscriber->closed = true;
+            subscriber->ready.notify_all();
+        }
+    }
+#ifdef __linux__
+    wake();
+    writer.join();
+    for (const auto& subscriber : subscribers) {
+        if (subscriber->sock >= 0) close(subscriber->sock);
+    }
+    close(wake_fd);
+    close(epoll_fd);
+#endif
+}
+
+void QuoteStream::publish(const std::vector<Quote>& quotes) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    std::vector<SymbolId> changed;
+    for (const Quote& quote : quotes) {
+        if (quote.symbol >= latest.size()) {
+            latest.resize(quote.symbol + 1);
+            events.resize(quote.symbol + 1);
+            seen.resize(quote.symbol + 1, false);
+        }
+        Quote& current = latest[quote.symbol];
+        if (seen[quote.symbol] && current.price == quote.price && current.volume == quote.volume) continue;
+        current = quote;
+        seen[quote.symbol] = true;
+        renderEvent(quote, events[quote.symbol]);
+        changed.push_back(quote.symbol);
+    }
+    if (changed.empty()) return;
+
+    // Subscribers following everything share one batch.
+    std::string everything;
+    for (SymbolId id : changed) everything += events[id];
+
+    std::string batch;
+    bool attached = false;
+    for (const auto& subscriber : subscribers) {
+        const std::string* pending = &everything;
+        size_t count = changed.size();
+        if (!subscriber->symbols.empty()) {
+            batch.clear();
+            count = 0;
+            for (SymbolId id : changed) {
+                if (subscriber->follows(id)) {
+                    batch += events[id];
+                    ++count;
+                }
+            }
+            if (count == 0) continue;
+            pending = &batch;
+        }
+        if (enqueue(*subscriber, *pending)) events_queued.fetch_add(count, std::memory_order_relaxed);
+        attached = attached || subscriber->sock >= 0;
+    }
+#ifdef __linux__
+    if (attached) wake();
+#endif
+}
+
+bool QuoteStream::enqueue(Subscriber& subscriber, const std::string& data) {
+    std::lock_guard<std::mutex> lock(subscriber.mtx);
+    if (subscriber.closed) return false;
+    size_t waiting = subscriber.queue.size() + (subscriber.sending.size() - subscriber.sent);
+    if (waiting + data.size() > queue_bytes) {
+        // Slow consumer: cut it off rather than buffer without bound.
+        subscriber.closed = true;
+        subscriber.ready.notify_all();
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    subscriber.queue += data;
+    subscriber.ready.notify_all();
+    return true;
+}
+
+std::shared_ptr<QuoteStream::Subscriber> QuoteStream::add(const std::vector<SymbolId>& symbols, int sock) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (stopping || subscribers.size() >= max_subscribers) return nullptr;
+
+    auto subscriber = std::make_shared<Subscriber>();
+    for (SymbolId id : symbols) {
+        if (id >= subscriber->symbols.size()) subscriber->symbols.resize(id + 1, false);
+        subscriber->symbols[id] = true;
+    }
+    subscriber->sock = sock;
+    // Current quotes go in regardless of the queue limit; the limit applies to what follows.
+    subscriber->queue = GREETING;
+    for (SymbolId id = 0; id < latest.size(); ++id) {
+        if (seen[id] && subscriber->follows(id)) subscriber->queue += events[id];
+    }
+    subscribers.push_back(subscriber);
+    return subscriber;
+}
+
+std::shared_ptr<QuoteStream::Subscriber> QuoteStream::subscribe(const std::vector<SymbolId>& symbols) {
+    return add(symbols, -1);
+}
+
+bool QuoteStream::next(Subscriber& subscriber, std::string& events, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(subscriber.mtx);
+    subscriber.ready.wait_for(lock, timeout, [&]() { return subscriber.closed || !subscriber.queue.empty(); });
+    if (subscriber.closed) return false;
+    events.clear();
+    events.swap(subscriber.queue);
+    return true;
+}
+
+void QuoteStream::unsubscribe(const std::shared_ptr<Subscriber>& subscriber) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (size_t i = 0; i < subscribers.size(); ++i) {
+        if (subscribers[i] == subscriber) {
+            subscribers[i] = std::move(subscribers.back());
+            subscribers.pop_back();
+            return;
+        }
+    }
+}
+
+bool QuoteStream::full() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return subscribers.size() >= max_subscribers;
+}
+
+QuoteStreamStats QuoteStream::stats() const {
+    QuoteStreamStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.subscribers = subscribers.size();
+    }
+    stats.events = events_queued.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+#ifdef __linux__
+
+namespace {
+constexpr int MAX_EVENTS = 256;
+}
+
+bool QuoteStream::attach(int sock, const std::vector<SymbolId>& symbols) {
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+    auto subscriber = add(symbols, sock);
+    if (!subscriber) {
+        close(sock);
+        return false;
+    }
+    // Edge-triggered: a writable edge after a short write resumes the flush.
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = subscriber.get();
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &event) != 0) {
+        std::lock_guard<std::mutex> lock(subscriber->mtx);
+        subscriber->closed = true;
+    }
+    wake();
+    return true;
+}
+
+void QuoteStream::wake() {
+    uint64_t one = 1;
+    ssize_t woken = write(wake_fd, &one, sizeof(one));
+    (void)woken; // already pending if the counter is full
+}
+
+void QuoteStream::run() {
+    epoll_event ready[MAX_EVENTS];
+    auto next_heartbeat = std::chrono::steady_clock::now() + HEARTBEAT;
+    std::vector<std::shared_ptr<Subscriber>> attached;
+    for (;;) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_heartbeat - std::chrono::steady_clock::now());
+        int count = epoll_wait(epoll_fd, ready, MAX_EVENTS, std::max<int>(0, static_cast<int>(wait.count())));
+
+        bool flush_all = false;
+        for (int i = 0; i < count; ++i) {
+            auto* subscriber = static_cast<Subscriber*>(ready[i].data.ptr);
+            if (subscriber == nullptr) {
+                uint64_t value;
+                ssize_t drained = read(wake_fd, &value, sizeof(value));
+                (void)drained;
+                flush_all = true;
+                continue;
+            }
+            if (ready[i].events & EPOLLIN) {
+                // Clients have nothing to say on this connection; a read of 0 means they left.
+                char discard[256];
+                ssize_t n;
+                while ((n = recv(subscriber->sock, discard, sizeof(discard), 0)) > 0) {}
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) ready[i].events |= EPOLLHUP;
+            }
+            if (ready[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                std::lock_guard<std::mutex> lock(subscriber->mtx);
+                subscriber->closed = true;
+            }
+            flush(*subscriber);
+        }
+
+        bool heartbeat = std::chrono::steady_clock::now() >= next_heartbeat;
+        if (heartbeat) next_heartbeat = std::chrono::steady_clock::now() + HEARTBEAT;
+        if (!flush_all && !heartbeat && count == 0) continue;
+
+        // Close the sockets of subscribers that left or were dropped, and
+        // send whatever publish() queued for the rest.
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (stopping) return;
+            attached.clear();
+            for (size_t i = 0; i < subscribers.size();) {
+                Subscriber& subscriber = *subscribers[i];
+                bool closed;
+                {
+                    std::lock_guard<std::mutex> subscriber_lock(subscriber.mtx);
+                    closed = subscriber.closed;
+                    if (heartbeat && !closed && subscriber.sock >= 0 && subscriber.queue.empty()) {
+                        subscriber.queue = KEEPALIVE;
+                    }
+                }
+                if (closed && subscriber.sock >= 0) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, subscriber.sock, nullptr);
+                    close(subscriber.sock);
+                    subscribers[i] = std::move(subscribers.back());
+                    subscribers.pop_back();
+                    continue;
+                }
+                if (subscriber.sock >= 0 && (flush_all || heartbeat)) attached.push_back(subscribers[i]);
+                ++i;
+            }
+        }
+        for (const auto& subscriber : attached) flush(*subscriber);
+        attached.clear();
+    }
+}
+
+void QuoteStream::flush(Subscriber& subscriber) {
+    std::lock_guard<std::mutex> lock(subscriber.mtx);
+    while (!subscriber.closed) {
+        if (subscriber.sent == subscriber.sending.size()) {
+            if (subscriber.queue.empty()) return;
+            // The response announced chunked encoding: one chunk per flush.
+            char size[20];
+            int length = std::snprintf(size, sizeof(size), "%zx\r\n", subscriber.queue.size());
+            subscriber.sending.assign(size, length);
+            subscriber.sending += subscriber.queue;
+            subscriber.sending += "\r\n";
+            subscriber.queue.clear();
+            subscriber.sent = 0;
+        }
+        ssize_t n = send(subscriber.sock, subscriber.sending.data() + subscriber.sent,
+                         subscriber.sending.size() - subscriber.sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            subscriber.sent += static_cast<size_t>(n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return; // resumed on the next writable edge
+        } else {
+            subscriber.closed = true;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef QUOTESTREAM_H
+#define QUOTESTREAM_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include "Quote.h"
+
+/**
+ * @struct QuoteStreamStats
+ * @brief Subscriber and delivery counters of a QuoteStream.
+ */
+struct QuoteStreamStats {
+    uint64_t subscribers = 0;
+    uint64_t events = 0;  // quote events queued, summed over subscribers
+    uint64_t dropped = 0; // subscribers disconnected for falling behind
+};
+
+/**
+ * @class QuoteStream
+ * @brief Pushes quote changes to Server-Sent Events subscribers.
+ *
+ * Each ingest publishes the latest quotes once. Only quotes that changed are
+ * rendered, once each, as an SSE event and appended to the queue of every
+ * subscriber whose symbol filter matches. A new subscriber first gets the
+ * current quote of every symbol it follows, so it never needs /stocks.
+ *
+ * Queues are bounded. A subscriber whose queue would overflow is dropped
+ * (disconnected) instead of holding memory or delaying anyone else; on
+ * reconnecting it starts again from current quotes.
+ *
+ * A subscriber is delivered to in one of two ways. An attached socket is
+ * written by the stream's own thread with non-blocking sends, so idle
+ * subscribers hold no request workers. Otherwise a worker pulls events
+ * with next() for the life of the subscription.
+ */
+class QuoteStream {
+public:
+    struct Subscriber;
+
+    static constexpr auto HEARTBEAT = std::chrono::seconds(15);
+
+    /**
+     * @param queue_bytes Events a subscriber may have waiting before it is dropped.
+     * @param max_subscribers Subscriptions refused beyond this many.
+     */
+    QuoteStream(size_t queue_bytes, size_t max_subscribers);
+    ~QuoteStream();
+
+    QuoteStream(const QuoteStream&) = delete;
+    QuoteStream& operator=(const QuoteStream&) = delete;
+
+    /**
+     * @brief Updates the current quotes and queues an event for each that changed.
+     */
+    void publish(const std::vector<Quote>& quotes);
+
+    /**
+     * @brief Subscribes a worker that will pull events with next().
+     * @param symbols Symbols to follow; empty follows every symbol.
+     * @return nullptr if the stream is at max_subscribers.
+     */
+    std::shared_ptr<Subscriber> subscribe(const std::vector<SymbolId>& symbols);
+
+    /**
+     * @brief Waits up to @p timeout for events and moves them into @p events.
+     * @return false once the subscriber has been dropped or the stream is closing.
+     */
+    bool next(Subscriber& subscriber, std::string& events, std::chrono::milliseconds timeout);
+
+    void unsubscribe(const std::shared_ptr<Subscriber>& subscriber);
+
+#ifdef __linux__
+    /**
+     * @brief Takes over a connection whose response headers, announcing a
+     *        chunked text/event-stream body, have been sent. The stream
+     *        writes the chunks and closes the socket when done.
+     * @return false, with the socket closed, if the stream is at max_subscribers.
+     */
+    bool attach(int sock, const std::vector<SymbolId>& symbols);
+#endif
+
+    bool full() const;
+    QuoteStreamStats stats() const;
+
+private:
+    std::shared_ptr<Subscriber> add(const std::vector<SymbolId>& symbols, int sock);
+    bool enqueue(Subscriber& subscriber, const std::string& events);
+
+    const size_t queue_bytes;
+    const size_t max_subscribers;
+
+    mutable std::mutex mtx; // guards the members below; taken before any Subscriber's
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    std::vector<Quote> latest;        // by SymbolId, where seen is set
+    std::vector<std::string> events;  // the SSE event for each quote in latest
+    std::vector<bool> seen;
+    bool stopping = false;
+
+    std::atomic<uint64_t> events_queued{0};
+    std::atomic<uint64_t> dropped{0};
+
+#ifdef __linux__
+    void run();
+    void flush(Subscriber& subscriber);
+    void wake();
+
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::thread writer;
+#endif
+};
+
+#endif // QUOTESTREAM_H
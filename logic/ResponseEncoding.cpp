@@ -0,0 +1,97 @@
+#include "ResponseEncoding.h"
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+struct MediaType {
+    const char* name;
+    Encoding encoding;
+};
+
+// Wildcards resolve to JSON, so plain clients are unaffected.
+const MediaType MEDIA_TYPES[] = {
+    {"application/json", Encoding::Json},
+    {"application/*", Encoding::Json},
+    {"*/*", Encoding::Json},
+    {"application/msgpack", Encoding::MsgPack},
+    {"application/x-msgpack", Encoding::MsgPack},
+    {"application/vnd.msgpack", Encoding::MsgPack},
+    {"application/cbor", Encoding::Cbor},
+    {"application/vnd.papertrading.quotes", Encoding::QuoteTable},
+};
+
+bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+bool equalsIgnoreCase(const std::string& text, size_t begin, size_t end, const char* name) {
+    for (; begin < end && *name; ++begin, ++name) {
+        if (std::tolower(static_cast<unsigned char>(text[begin])) != *name) return false;
+    }
+    return begin == end && *name == '\0';
+}
+
+} // namespace
+
+Encoding negotiateEncoding(const std::string& accept, bool allow_quote_table) {
+    Encoding best = Encoding::Json;
+    double best_q = 0;
+    size_t start = 0;
+    while (start < accept.size()) {
+        size_t end = accept.find(',', start);
+        if (end == std::string::npos) end = accept.size();
+
+        size_t params = accept.find(';', start);
+        if (params > end) params = end;
+        size_t type_begin = start, type_end = params;
+        while (type_begin < type_end && isSpace(accept[type_begin])) ++type_begin;
+        while (type_end > type_begin && isSpace(accept[type_end - 1])) --type_end;
+
+        double q = 1;
+        size_t q_at = accept.find("q=", params);
+        if (q_at < end) q = std::strtod(accept.c_str() + q_at + 2, nullptr);
+
+        for (const MediaType& type : MEDIA_TYPES) {
+            if (!equalsIgnoreCase(accept, type_begin, type_end, type.name)) continue;
+            if (type.encoding == Encoding::QuoteTable && !allow_quote_table) break;
+            if (q > best_q) {
+                best = type.encoding;
+                best_q = q;
+            }
+            break;
+        }
+        start = end + 1;
+    }
+    return best;
+}
+
+const char* contentType(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::MsgPack: return "application/msgpack";
+    case Encoding::Cbor: return "application/cbor";
+    case Encoding::QuoteTable: return "application/vnd.papertrading.quotes";
+    default: return "application/json";
+    }
+}
+
+const char* etagSuffix(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::MsgPack: return "-msgpack";
+    case Encoding::Cbor: return "-cbor";
+    case Encoding::QuoteTable: return "-quotes";
+    default: return "";
+    }
+}
+
+void encodeDocument(const nlohmann::json& document, Encoding encoding, std::string& out) {
+    switch (encoding) {
+    case Encoding::MsgPack:
+        nlohmann::json::to_msgpack(document, out);
+        break;
+    case Encoding::Cbor:
+        nlohmann::json::to_cbor(document, out);
+        break;
+    default:
+        out += document.dump();
+        break;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef RESPONSEENCODING_H
+#define RESPONSEENCODING_H
+
+#include <string>
+#include "json.hpp"
+
+/**
+ * @brief Wire formats a response can be sent in, chosen from the Accept header.
+ *
+ * MessagePack and CBOR carry the same document as the JSON body. QuoteTable
+ * is the fixed-layout quote format described in QuoteCache.h and is only
+ * offered by /stocks.
+ */
+enum class Encoding : uint8_t {
+    Json,
+    MsgPack,
+    Cbor,
+    QuoteTable,
+};
+
+constexpr size_t ENCODING_COUNT = 4;
+
+/**
+ * @brief Picks the encoding the client prefers among those offered.
+ *
+ * Follows the q-values in @p accept; equal weights go to the type listed
+ * first. Falls back to JSON when the header is missing or names nothing we
+ * serve, rather than answering 406.
+ * @param allow_quote_table Whether QuoteTable may be chosen.
+ */
+Encoding negotiateEncoding(const std::string& accept, bool allow_quote_table = false);
+
+const char* contentType(Encoding encoding);
+
+// Suffix distinguishing the ETag of each encoding of the same data; empty for JSON.
+const char* etagSuffix(Encoding encoding);
+
+/**
+ * @brief Appends @p document to @p out as MessagePack or CBOR, or as JSON
+ *        text for Encoding::Json. QuoteTable is not a document encoding.
+ */
+void encodeDocument(const nlohmann::json& document, Encoding encoding, std::string& out);
+
+#endif // RESPONSEENCODING_H
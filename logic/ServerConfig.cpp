@@ -0,0 +1,49 @@
+#include "ServerConfig.h"
+#include "Logger.h"
+#include "json.hpp"
+#include <fstream>
+#include <thread>
+#include <algorithm>
+
+using json = nlohmann::json;
+
+bool ServerConfig::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        Logger::info("No {}; using default server settings", path);
+    } else {
+        try {
+            json j = json::parse(file);
+            host = j.value("host", host);
+            port = j.value("port", port);
+            threads = j.value("threads", threads);
+            max_queued_requests = j.value("maxQueuedRequests", max_queued_requests);
+            event_loop = j.value("eventLoop", event_loop);
+            keep_alive_timeout_sec = j.value("keepAliveTimeoutSec", keep_alive_timeout_sec);
+            keep_alive_max_count = j.value("keepAliveMaxCount", keep_alive_max_count);
+            read_timeout_sec = j.value("readTimeoutSec", read_timeout_sec);
+            write_timeout_sec = j.value("writeTimeoutSec", write_timeout_sec);
+            stream_queue_bytes = j.value("streamQueueBytes", stream_queue_bytes);
+            max_stream_subscribers = j.value("maxStreamSubscribers", max_stream_subscribers);
+            account_shards = j.value("accountShards", account_shards);
+            session_secret = j.value("sessionSecret", session_secret);
+            session_ttl_sec = j.value("sessionTtlSec", session_ttl_sec);
+            admin_token = j.value("adminToken", admin_token);
+            if (j.contains("logLevel") && !parseLogLevel(j["logLevel"].get<std::string>(), log_level)) {
+                Logger::error("Invalid server config {}: unknown logLevel", path);
+                return false;
+            }
+        } catch (const std::exception& e) {
+            Logger::error("Invalid server config {}: {}", path, e.what());
+            return false;
+        }
+    }
+
+    if (threads == 0) {
+        threads = std::max(8u, std::thread::hardware_concurrency());
+    }
+    if (keep_alive_max_count == 0) {
+        keep_alive_max_count = 1;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef SERVERCONFIG_H
+#define SERVERCONFIG_H
+
+#include <string>
+#include <cstddef>
+#include <ctime>
+#include "Logger.h"
+
+/**
+ * @struct ServerConfig
+ * @brief Listener and connection settings for the API server.
+ *
+ * Read from a JSON file whose keys are the camelCase forms of the fields
+ * below; missing keys keep their defaults.
+ */
+struct ServerConfig {
+    std::string host = "localhost";
+    int port = 8080;
+    size_t threads = 0;             // request workers; 0 picks one per core, at least 8
+    size_t max_queued_requests = 0; // requests waiting for a worker; 0 is unbounded
+    bool event_loop = true;         // park idle keep-alive connections off the workers (Linux)
+    time_t keep_alive_timeout_sec = 5;
+    size_t keep_alive_max_count = 100;
+    time_t read_timeout_sec = 5;
+    time_t write_timeout_sec = 5;
+    LogLevel log_level = LogLevel::Info; // can be changed at runtime through /log_level (needs admin_token)
+    size_t stream_queue_bytes = 256 * 1024; // per /quotes/stream subscriber before it is dropped
+    size_t max_stream_subscribers = 10000;
+    size_t account_shards = 0;    // account threads in journaled mode; 0 is one per core
+    std::string session_secret;   // HMAC key for session tokens; empty generates one per run
+    time_t session_ttl_sec = 86400;
+    std::string admin_token;      // bearer token for admin endpoints; empty disables them
+
+    /**
+     * @brief Loads settings from @p path. A missing file leaves the defaults.
+     * @return false if the file exists but cannot be parsed.
+     */
+    bool load(const std::string& path);
+};
+
+#endif // SERVERCONFIG_H
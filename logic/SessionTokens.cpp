@@ -0,0 +1,163 @@
+#include "SessionTokens.h"
+#include "Logger.h"
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <charconv>
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MAC_BYTES = 32;      // SHA-256
+constexpr size_t SIGNATURE_CHARS = 43; // MAC_BYTES in unpadded base64url
+constexpr size_t KEY_BYTES = 32;
+
+const char BASE64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+int64_t unixNow() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void randomBytes(void* out, size_t size) {
+    if (RAND_bytes(static_cast<unsigned char*>(out), static_cast<int>(size)) != 1) {
+        throw std::runtime_error("Could not generate random bytes");
+    }
+}
+
+// Each thread keeps one HMAC context keyed for the instance that used it
+// last. Re-initializing it without a key restarts from the keyed state,
+// which is far cheaper than setting up HMAC for every token.
+struct MacContext {
+    uint64_t owner = 0;
+    EVP_MAC_CTX* ctx = nullptr;
+    ~MacContext() { EVP_MAC_CTX_free(ctx); }
+};
+thread_local MacContext mac_context;
+std::atomic<uint64_t> next_instance{1};
+
+// Parses one number of the claims and moves @p at past it.
+template <typename T>
+bool parseField(const char*& at, const char* end, T& value, int base) {
+    auto result = std::from_chars(at, end, value, base);
+    if (result.ec != std::errc() || result.ptr == at) return false;
+    at = result.ptr;
+    return true;
+}
+
+} // namespace
+
+SessionTokens::SessionTokens(const std::string& secret, std::chrono::seconds ttl)
+    : key(secret), ttl(ttl), instance(next_instance.fetch_add(1)), hmac(EVP_MAC_fetch(nullptr, "HMAC", nullptr)) {
+    if (hmac == nullptr) {
+        throw std::runtime_error("HMAC is not available from OpenSSL");
+    }
+    if (key.empty()) {
+        key.resize(KEY_BYTES);
+        randomBytes(&key[0], key.size());
+        Logger::info("No session secret configured; sessions will not survive a restart");
+    }
+}
+
+SessionTokens::~SessionTokens() {
+    EVP_MAC_free(hmac);
+}
+
+void SessionTokens::sign(std::string_view claims, char* signature) const {
+    MacContext& context = mac_context;
+    if (context.owner != instance) {
+        EVP_MAC_CTX_free(context.ctx);
+        context.owner = 0;
+        context.ctx = EVP_MAC_CTX_new(hmac);
+        char digest[] = "SHA256";
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+            OSSL_PARAM_construct_end(),
+        };
+        if (context.ctx == nullptr ||
+            !EVP_MAC_init(context.ctx, reinterpret_cast<const unsigned char*>(key.data()), key.size(), params)) {
+            throw std::runtime_error("Could not set up HMAC-SHA256");
+        }
+        context.owner = instance;
+    } else if (!EVP_MAC_init(context.ctx, nullptr, 0, nullptr)) {
+        throw std::runtime_error("Could not reset HMAC-SHA256");
+    }
+    unsigned char mac[MAC_BYTES];
+    size_t length = 0;
+    EVP_MAC_update(context.ctx, reinterpret_cast<const unsigned char*>(claims.data()), claims.size());
+    EVP_MAC_final(context.ctx, mac, &length, sizeof(mac));
+
+    // base64url without padding: 10 full groups of 3 bytes, then 2 bytes left
+    size_t out = 0;
+    size_t i = 0;
+    for (; i + 3 <= MAC_BYTES; i += 3) {
+        uint32_t group = (uint32_t(mac[i]) << 16) | (uint32_t(mac[i + 1]) << 8) | mac[i + 2];
+        signature[out++] = BASE64URL[(group >> 18) & 63];
+        signature[out++] = BASE64URL[(group >> 12) & 63];
+        signature[out++] = BASE64URL[(group >> 6) & 63];
+        signature[out++] = BASE64URL[group & 63];
+    }
+    uint32_t group = (uint32_t(mac[i]) << 16) | (uint32_t(mac[i + 1]) << 8);
+    signature[out++] = BASE64URL[(group >> 18) & 63];
+    signature[out++] = BASE64URL[(group >> 12) & 63];
+    signature[out++] = BASE64URL[(group >> 6) & 63];
+}
+
+std::string SessionTokens::issue(int user_id, Session& session) {
+    session.user_id = user_id;
+    session.expires_at = unixNow() + ttl.count();
+    randomBytes(&session.token_id, sizeof(session.token_id));
+
+    char claims[64];
+    int length = std::snprintf(claims, sizeof(claims), "%d.%lld.%016llx", user_id,
+                               static_cast<long long>(session.expires_at),
+                               static_cast<unsigned long long>(session.token_id));
+    std::string token(claims, length);
+    token += '.';
+    char signature[SIGNATURE_CHARS];
+    sign(std::string_view(claims, length), signature);
+    token.append(signature, SIGNATURE_CHARS);
+    return token;
+}
+
+bool SessionTokens::verify(std::string_view token, Session& session) const {
+    size_t dot = token.rfind('.');
+    if (dot == std::string_view::npos || token.size() - dot - 1 != SIGNATURE_CHARS) return false;
+
+    std::string_view claims = token.substr(0, dot);
+    char expected[SIGNATURE_CHARS];
+    sign(claims, expected);
+    if (CRYPTO_memcmp(expected, token.data() + dot + 1, SIGNATURE_CHARS) != 0) return false;
+
+    // Signed by us, so well-formed unless the format changed under it.
+    const char* at = claims.data();
+    const char* end = at + claims.size();
+    if (!parseField(at, end, session.user_id, 10) || at == end || *at++ != '.' ||
+        !parseField(at, end, session.expires_at, 10) || at == end || *at++ != '.' ||
+        !parseField(at, end, session.token_id, 16) || at != end) {
+        return false;
+    }
+    if (session.expires_at <= unixNow()) return false;
+
+    if (revoked_count.load(std::memory_order_acquire) == 0) return true;
+    std::shared_lock<std::shared_mutex> lock(revoked_mtx);
+    return revoked.find(session.token_id) == revoked.end();
+}
+
+void SessionTokens::revoke(const Session& session) {
+    std::unique_lock<std::shared_mutex> lock(revoked_mtx);
+    revoked[session.token_id] = session.expires_at;
+    if (revoked.size() >= purge_at) {
+        int64_t now = unixNow();
+        for (auto it = revoked.begin(); it != revoked.end();) {
+            it = it->second <= now ? revoked.erase(it) : std::next(it);
+        }
+        purge_at = std::max<size_t>(1024, revoked.size() * 2);
+    }
+    revoked_count.store(revoked.size(), std::memory_order_release);
+}
@@ -0,0 +1,81 @@
+#ifndef SESSIONTOKENS_H
+#define SESSIONTOKENS_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+struct evp_mac_st;
+
+/**
+ * @struct Session
+ * @brief What a verified session token says about its holder.
+ */
+struct Session {
+    int user_id = -1;
+    int64_t expires_at = 0; // Unix seconds
+    uint64_t token_id = 0;  // random, names the token for revocation
+};
+
+/**
+ * @class SessionTokens
+ * @brief Issues and verifies stateless, HMAC-SHA256-signed session tokens.
+ *
+ * A token is "<userId>.<expiresAt>.<tokenId>.<signature>", the signature
+ * being the base64url HMAC of everything before it. Verifying one needs no
+ * database access and no shared state beyond the revocation set, which is
+ * consulted only when it is non-empty. Revoked ids are kept until the token
+ * would have expired anyway.
+ *
+ * With no configured secret a random key is generated, so tokens stop
+ * verifying when the process restarts and users log in again.
+ */
+class SessionTokens {
+public:
+    /**
+     * @param secret HMAC key; empty generates a random one.
+     * @param ttl How long an issued token stays valid.
+     */
+    SessionTokens(const std::string& secret, std::chrono::seconds ttl);
+    ~SessionTokens();
+
+    SessionTokens(const SessionTokens&) = delete;
+    SessionTokens& operator=(const SessionTokens&) = delete;
+
+    /**
+     * @brief Returns a new token for @p user_id; @p session receives its claims.
+     */
+    std::string issue(int user_id, Session& session);
+
+    /**
+     * @brief Checks a token's signature, expiry and revocation.
+     * @return false if the token is malformed, forged, expired or revoked.
+     */
+    bool verify(std::string_view token, Session& session) const;
+
+    /**
+     * @brief Rejects the token named by @p session from now until it expires.
+     */
+    void revoke(const Session& session);
+
+    size_t revokedCount() const { return revoked_count.load(std::memory_order_relaxed); }
+
+private:
+    void sign(std::string_view claims, char* signature) const;
+
+    std::string key;
+    std::chrono::seconds ttl;
+    uint64_t instance; // tells apart the per-thread HMAC contexts of different instances
+    evp_mac_st* hmac; // OpenSSL's EVP_MAC
+
+    mutable std::shared_mutex revoked_mtx;
+    std::unordered_map<uint64_t, int64_t> revoked; // token id -> expiry
+    std::atomic<size_t> revoked_count{0};
+    size_t purge_at = 1024; // next size at which expired ids are dropped
+};
+
+#endif // SESSIONTOKENS_H
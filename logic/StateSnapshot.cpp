@@ -0,0 +1,255 @@
+#include "StateSnapshot.h"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'T', 'K', 'S', 'N', 'A', 'P', '1'};
+constexpr size_t HEADER_SIZE = 128;
+
+struct DiskHeader {
+    char magic[8];
+    uint64_t journals;
+    uint64_t accounts;
+    uint64_t positions;
+    uint64_t symbols;
+    uint64_t quotes;
+    uint64_t name_bytes;   // total length of all usernames
+    uint64_t symbol_bytes; // total length of all symbol names
+    uint64_t file_size;
+    uint8_t reserved[56];
+};
+static_assert(sizeof(DiskHeader) == HEADER_SIZE, "snapshot header must be 128 bytes");
+
+// Byte offset of each array in the file, in the order they are stored.
+struct Layout {
+    size_t journal_seqs;
+    size_t user_ids, cash, offsets, name_offsets, names;
+    size_t symbol_offsets, symbol_names;
+    size_t position_symbols, quantities, costs;
+    size_t quote_symbols, quote_prices, quote_volumes;
+    size_t end;
+};
+
+Layout layoutFor(const DiskHeader& h) {
+    size_t at = HEADER_SIZE;
+    auto take = [&at](size_t bytes) {
+        size_t start = at;
+        at = (at + bytes + 7) & ~size_t(7);
+        return start;
+    };
+    Layout l;
+    l.journal_seqs = take(h.journals * sizeof(uint64_t));
+    l.user_ids = take(h.accounts * sizeof(int32_t));
+    l.cash = take(h.accounts * sizeof(int64_t));
+    l.offsets = take((h.accounts + 1) * sizeof(uint32_t));
+    l.name_offsets = take((h.accounts + 1) * sizeof(uint32_t));
+    l.names = take(h.name_bytes);
+    l.symbol_offsets = take((h.symbols + 1) * sizeof(uint32_t));
+    l.symbol_names = take(h.symbol_bytes);
+    l.position_symbols = take(h.positions * sizeof(uint32_t));
+    l.quantities = take(h.positions * sizeof(int64_t));
+    l.costs = take(h.positions * sizeof(int64_t));
+    l.quote_symbols = take(h.quotes * sizeof(uint32_t));
+    l.quote_prices = take(h.quotes * sizeof(int64_t));
+    l.quote_volumes = take(h.quotes * sizeof(int64_t));
+    l.end = at;
+    return l;
+}
+
+// Offsets must start at 0, never decrease and end at @p total.
+bool validOffsets(const uint32_t* offsets, size_t count, size_t total) {
+    if (offsets[0] != 0 || offsets[count] != total) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1]) return false;
+    }
+    return true;
+}
+
+template <typename T>
+const T* at(const uint8_t* base, size_t offset) {
+    return reinterpret_cast<const T*>(base + offset);
+}
+
+template <typename T>
+void put(uint8_t* base, size_t offset, const T* data, size_t count) {
+    if (count > 0) std::memcpy(base + offset, data, count * sizeof(T));
+}
+
+} // namespace
+
+bool StateSnapshot::fail(const std::string& what) {
+    last_error = what;
+    return false;
+}
+
+bool StateSnapshot::write(const std::string& path, const std::vector<uint64_t>& seqs, const PositionColumns& columns,
+                          const std::vector<Quote>& quote_list, std::string& error) {
+    const SymbolTable& table = SymbolTable::global();
+
+    DiskHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.journals = seqs.size();
+    header.accounts = columns.user_ids.size();
+    header.positions = columns.symbols.size();
+    header.symbols = table.size();
+    header.quotes = quote_list.size();
+
+    std::vector<uint32_t> name_offsets(1, 0);
+    for (const std::string& name : columns.usernames) {
+        header.name_bytes += name.size();
+        name_offsets.push_back(static_cast<uint32_t>(header.name_bytes));
+    }
+    std::vector<uint32_t> symbol_offsets(1, 0);
+    for (SymbolId id = 0; id < header.symbols; ++id) {
+        header.symbol_bytes += table.name(id).size();
+        symbol_offsets.push_back(static_cast<uint32_t>(header.symbol_bytes));
+    }
+    Layout layout = layoutFor(header);
+    header.file_size = layout.end;
+
+    std::string temp_path = path + ".tmp";
+    std::remove(temp_path.c_str());
+    {
+        MappedFile temp;
+        if (!temp.open(temp_path, layout.end)) {
+            error = temp.error();
+            return false;
+        }
+        uint8_t* base = temp.data();
+        std::memcpy(base, &header, sizeof(header));
+        put(base, layout.journal_seqs, seqs.data(), header.journals);
+
+        for (size_t i = 0; i < header.accounts; ++i) {
+            int32_t user_id = columns.user_ids[i];
+            std::memcpy(base + layout.user_ids + i * sizeof(int32_t), &user_id, sizeof(user_id));
+        }
+        put(base, layout.cash, columns.cash.data(), header.accounts);
+        put(base, layout.offsets, columns.offsets.data(), header.accounts + 1);
+        put(base, layout.name_offsets, name_offsets.data(), header.accounts + 1);
+        for (size_t i = 0; i < header.accounts; ++i) {
+            put(base, layout.names + name_offsets[i], columns.usernames[i].data(), columns.usernames[i].size());
+        }
+        put(base, layout.symbol_offsets, symbol_offsets.data(), header.symbols + 1);
+        for (SymbolId id = 0; id < header.symbols; ++id) {
+            const std::string& name = table.name(id);
+            put(base, layout.symbol_names + symbol_offsets[id], name.data(), name.size());
+        }
+        put(base, layout.position_symbols, columns.symbols.data(), header.positions);
+        put(base, layout.quantities, columns.quantities.data(), header.positions);
+        put(base, layout.costs, columns.costs.data(), header.positions);
+        for (size_t i = 0; i < header.quotes; ++i) {
+            uint32_t symbol = quote_list[i].symbol;
+            int64_t price = quote_list[i].price.getMicros();
+            put(base, layout.quote_symbols + i * sizeof(uint32_t), &symbol, 1);
+            put(base, layout.quote_prices + i * sizeof(int64_t), &price, 1);
+            put(base, layout.quote_volumes + i * sizeof(int64_t), &quote_list[i].volume, 1);
+        }
+
+        if (!temp.flush(0, layout.end)) {
+            error = temp.error();
+            return false;
+        }
+    }
+    return MappedFile::replace(temp_path, path, error);
+}
+
+bool StateSnapshot::open(const std::string& path) {
+    if (!file.open(path, 0, true)) return fail(file.error());
+    if (file.size() < HEADER_SIZE) return fail(path + " is too short to be a snapshot");
+
+    DiskHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return fail(path + " is not a snapshot");
+    // Every count is bounded by the file size, so the layout cannot overflow.
+    if (header.file_size != file.size() || header.journals > file.size() || header.accounts > file.size() ||
+        header.positions > file.size() || header.symbols > file.size() || header.quotes > file.size() ||
+        header.name_bytes > file.size() || header.symbol_bytes > file.size()) {
+        return fail(path + " is truncated or corrupt");
+    }
+    Layout layout = layoutFor(header);
+    if (layout.end != file.size()) return fail(path + " is truncated or corrupt");
+
+    const uint8_t* base = file.data();
+    user_ids = at<int32_t>(base, layout.user_ids);
+    cash = at<int64_t>(base, layout.cash);
+    offsets = at<uint32_t>(base, layout.offsets);
+    name_offsets = at<uint32_t>(base, layout.name_offsets);
+    names = at<char>(base, layout.names);
+    position_symbols = at<uint32_t>(base, layout.position_symbols);
+    quantities = at<int64_t>(base, layout.quantities);
+    costs = at<int64_t>(base, layout.costs);
+    quote_symbols = at<uint32_t>(base, layout.quote_symbols);
+    quote_prices = at<int64_t>(base, layout.quote_prices);
+    quote_volumes = at<int64_t>(base, layout.quote_volumes);
+
+    const uint32_t* symbol_offsets = at<uint32_t>(base, layout.symbol_offsets);
+    const char* symbol_names = at<char>(base, layout.symbol_names);
+    if (!validOffsets(offsets, header.accounts, header.positions) ||
+        !validOffsets(name_offsets, header.accounts, header.name_bytes) ||
+        !validOffsets(symbol_offsets, header.symbols, header.symbol_bytes)) {
+        return fail(path + " has inconsistent offsets");
+    }
+    for (size_t i = 1; i < header.accounts; ++i) {
+        if (user_ids[i - 1] >= user_ids[i]) return fail(path + " has unordered accounts");
+    }
+    for (size_t i = 0; i < header.positions; ++i) {
+        if (position_symbols[i] >= header.symbols) return fail(path + " has an unknown symbol");
+    }
+    for (size_t i = 0; i < header.quotes; ++i) {
+        if (quote_symbols[i] >= header.symbols) return fail(path + " has an unknown symbol");
+    }
+
+    symbol_ids.clear();
+    SymbolTable& table = SymbolTable::global();
+    for (size_t i = 0; i < header.symbols; ++i) {
+        symbol_ids.push_back(table.intern(std::string_view(symbol_names + symbol_offsets[i],
+                                                           symbol_offsets[i + 1] - symbol_offsets[i])));
+    }
+
+    const uint64_t* seqs = at<uint64_t>(base, layout.journal_seqs);
+    journal_seqs.assign(seqs, seqs + header.journals);
+    accounts = header.accounts;
+    positions = header.positions;
+    quotes = header.quotes;
+    return true;
+}
+
+bool StateSnapshot::loadAccount(int user_id, Portfolio& portfolio) const {
+    const int32_t* end = user_ids + accounts;
+    const int32_t* found = std::lower_bound(user_ids, end, user_id);
+    if (found == end || *found != user_id) return false;
+
+    size_t account = found - user_ids;
+    portfolio.setFundBalance(Money::fromMicros(cash[account]));
+    portfolio.reserve(offsets[account + 1] - offsets[account]);
+    for (uint32_t p = offsets[account]; p < offsets[account + 1]; ++p) {
+        int64_t quantity = quantities[p];
+        if (quantity <= 0) continue;
+        portfolio.addStock(Stock(symbol_ids[position_symbols[p]], static_cast<int>(quantity),
+                                 Money::fromMicros(costs[p] / quantity)));
+    }
+    return true;
+}
+
+void StateSnapshot::loadColumns(PositionColumns& columns) const {
+    columns = PositionColumns();
+    columns.user_ids.assign(user_ids, user_ids + accounts);
+    columns.cash.assign(cash, cash + accounts);
+    columns.offsets.assign(offsets, offsets + accounts + 1);
+    columns.usernames.reserve(accounts);
+    for (size_t i = 0; i < accounts; ++i) {
+        columns.usernames.emplace_back(names + name_offsets[i], name_offsets[i + 1] - name_offsets[i]);
+    }
+    columns.symbols.resize(positions);
+    for (size_t i = 0; i < positions; ++i) columns.symbols[i] = symbol_ids[position_symbols[i]];
+    columns.quantities.assign(quantities, quantities + positions);
+    columns.costs.assign(costs, costs + positions);
+}
+
+void StateSnapshot::loadQuotes(std::vector<Quote>& out) const {
+    for (size_t i = 0; i < quotes; ++i) {
+        out.push_back({symbol_ids[quote_symbols[i]], Money::fromMicros(quote_prices[i]), quote_volumes[i]});
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.h"
+#include "ValuationEngine.h"
+#include "Portfolio.h"
+#include "Quote.h"
+
+/**
+ * @class StateSnapshot
+ * @brief Read-only view of every account, position and latest quote as of
+ *        one sequence number in each trade journal, mapped straight from disk.
+ *
+ * The file is a fixed header followed by the journal sequence numbers, the
+ * columns of a PositionColumns and the quotes, each array 8-byte aligned, so opening one is a map and a
+ * bounds check rather than a parse. Symbols are stored by name and remapped
+ * to this process's SymbolIds on open. Snapshots are written to a temporary
+ * file and renamed into place, so a reader sees either the old file or the
+ * complete new one.
+ */
+class StateSnapshot {
+public:
+    StateSnapshot() = default;
+
+    StateSnapshot(const StateSnapshot&) = delete;
+    StateSnapshot& operator=(const StateSnapshot&) = delete;
+
+    /**
+     * @brief Writes a snapshot to @p path.
+     * @param seqs Last record of each trade journal reflected in @p accounts.
+     */
+    static bool write(const std::string& path, const std::vector<uint64_t>& seqs, const PositionColumns& accounts,
+                      const std::vector<Quote>& quotes, std::string& error);
+
+    /**
+     * @brief Maps and validates a snapshot written by write().
+     */
+    bool open(const std::string& path);
+
+    const std::vector<uint64_t>& seqs() const { return journal_seqs; }
+    size_t accountCount() const { return accounts; }
+
+    /**
+     * @brief Loads one account's cash and positions, at average cost.
+     * @return false if the user is not in the snapshot.
+     */
+    bool loadAccount(int user_id, Portfolio& portfolio) const;
+
+    /**
+     * @brief Copies every account and position out of the mapping.
+     */
+    void loadColumns(PositionColumns& columns) const;
+
+    /**
+     * @brief Appends the latest quote of every symbol as of the snapshot.
+     */
+    void loadQuotes(std::vector<Quote>& quotes) const;
+
+    const std::string& error() const { return last_error; }
+
+private:
+    bool fail(const std::string& what);
+
+    MappedFile file;
+    std::vector<uint64_t> journal_seqs;
+    size_t accounts = 0;
+    size_t positions = 0;
+    size_t quotes = 0;
+    std::vector<SymbolId> symbol_ids; // file symbol index -> SymbolId
+
+    // Arrays inside the mapping
+    const int32_t* user_ids = nullptr;
+    const int64_t* cash = nullptr;
+    const uint32_t* offsets = nullptr;
+    const uint32_t* name_offsets = nullptr;
+    const char* names = nullptr;
+    const uint32_t* position_symbols = nullptr;
+    const int64_t* quantities = nullptr;
+    const int64_t* costs = nullptr;
+    const uint32_t* quote_symbols = nullptr;
+    const int64_t* quote_prices = nullptr;
+    const int64_t* quote_volumes = nullptr;
+
+    std::string last_error;
+};
+
+#endif // STATESNAPSHOT_H
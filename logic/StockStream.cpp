@@ -0,0 +1,145 @@
+#include "StockStream.h"
+#include "Logger.h"
+#include <sqlite3.h>
+
+namespace {
+
+enum class FieldType { Text, Integer, Real };
+
+struct Field {
+    const char* name;
+    const char* key; // pre-encoded for JsonWriter::key()
+    const char* column;
+    FieldType type;
+};
+
+// Sorted by name, the order the full /stocks snapshot writes its keys in.
+const Field FIELDS[StockStream::FIELD_COUNT] = {
+    {"CompanyName", "\"CompanyName\":", "s.CompanyName", FieldType::Text},
+    {"DayHigh", "\"DayHigh\":", "s.DayHigh", FieldType::Real},
+    {"DayLow", "\"DayLow\":", "s.DayLow", FieldType::Real},
+    {"DividendYield", "\"DividendYield\":", "s.DividendYield", FieldType::Real},
+    {"FiftyTwoWeekHigh", "\"FiftyTwoWeekHigh\":", "s.FiftyTwoWeekHigh", FieldType::Real},
+    {"FiftyTwoWeekLow", "\"FiftyTwoWeekLow\":", "s.FiftyTwoWeekLow", FieldType::Real},
+    {"PERatio", "\"PERatio\":", "s.PERatio", FieldType::Real},
+    {"PreviousClose", "\"PreviousClose\":", "s.PreviousClose", FieldType::Real},
+    {"Price", "\"Price\":", "q.Price", FieldType::Real},
+    {"Symbol", "\"Symbol\":", "s.Symbol", FieldType::Text},
+    {"Volume", "\"Volume\":", "q.Volume", FieldType::Integer},
+};
+const size_t SYMBOL = 9;
+
+const size_t CHUNK_BYTES = 16 * 1024;
+
+// One SQL text per field mask, so each projection is prepared once per
+// connection and then served from its statement cache. The symbol is always
+// selected, last if it was not asked for, to track the cursor.
+std::string selectSql(uint32_t fields) {
+    std::string sql = "SELECT ";
+    for (size_t field = 0; field < StockStream::FIELD_COUNT; ++field) {
+        if (fields & (uint32_t(1) << field)) {
+            sql += FIELDS[field].column;
+            sql += ", ";
+        }
+    }
+    if (!(fields & (uint32_t(1) << SYMBOL))) {
+        sql += "s.Symbol, ";
+    }
+    sql.resize(sql.size() - 2);
+    // The unique index on Symbol gives the order; LIMIT fetches one row past
+    // the page to tell whether another page follows.
+    sql += " FROM Stock s JOIN LatestQuote q ON q.StockID = s.StockID"
+           " WHERE s.Symbol > ? ORDER BY s.Symbol LIMIT ?;";
+    return sql;
+}
+
+} // namespace
+
+bool StockStream::parseFields(const std::string& list, uint32_t& fields) {
+    fields = 0;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        size_t field = 0;
+        while (field < FIELD_COUNT && list.compare(start, end - start, FIELDS[field].name) != 0) ++field;
+        if (field == FIELD_COUNT) return false;
+        fields |= uint32_t(1) << field;
+        start = end + 1;
+    }
+    return fields != 0;
+}
+
+StockStream::StockStream(Connection& conn, uint32_t fields, const std::string& after, size_t limit)
+    : conn(conn), stmt(conn.prepare(selectSql(fields).c_str())), limit(limit) {
+    for (size_t field = 0; field < FIELD_COUNT; ++field) {
+        if (fields & (uint32_t(1) << field)) {
+            if (field == SYMBOL) symbol_column = column_count;
+            columns[column_count++] = static_cast<uint8_t>(field);
+        }
+    }
+    if (!(fields & (uint32_t(1) << SYMBOL))) symbol_column = column_count;
+
+    if (!stmt) {
+        Logger::error("Failed to prepare statement for streaming stocks: {}", sqlite3_errmsg(conn.handle()));
+        failed = true;
+        return;
+    }
+    sqlite3_bind_text(stmt.get(), 1, after.data(), static_cast<int>(after.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt.get(), 2, static_cast<sqlite3_int64>(limit) + 1);
+    step();
+}
+
+bool StockStream::step() {
+    int rc = sqlite3_step(stmt.get());
+    has_row = rc == SQLITE_ROW;
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        Logger::error("Failed to read stocks: {}", sqlite3_errmsg(conn.handle()));
+        failed = true;
+    }
+    return has_row;
+}
+
+const std::string& StockStream::next() {
+    chunk.clear();
+    if (failed || finished) return chunk;
+
+    if (rows == 0) {
+        writer.beginObject();
+        writer.key("\"stocks\":");
+        writer.beginArray();
+    }
+    while (has_row && rows < limit && chunk.size() < CHUNK_BYTES) {
+        sqlite3_stmt* row = stmt.get();
+        writer.beginObject();
+        for (int column = 0; column < column_count; ++column) {
+            const Field& field = FIELDS[columns[column]];
+            writer.key(field.key);
+            if (field.type == FieldType::Text)
+                writer.value(reinterpret_cast<const char*>(sqlite3_column_text(row, column)));
+            else if (field.type == FieldType::Integer)
+                writer.value(static_cast<int64_t>(sqlite3_column_int64(row, column)));
+            else
+                writer.value(sqlite3_column_double(row, column));
+        }
+        writer.endObject();
+        if (++rows == limit) {
+            cursor = reinterpret_cast<const char*>(sqlite3_column_text(row, symbol_column));
+        }
+        step();
+    }
+    if (failed) {
+        chunk.clear();
+        return chunk;
+    }
+    if (has_row && rows < limit) return chunk;
+
+    // has_row here means the page is full and the row past it exists.
+    writer.endArray();
+    writer.key("\"nextCursor\":");
+    if (has_row) writer.value(cursor);
+    else writer.null();
+    writer.endObject();
+    finished = true;
+    return chunk;
+}
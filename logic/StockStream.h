@@ -0,0 +1,76 @@
+#ifndef STOCKSTREAM_H
+#define STOCKSTREAM_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "ConnectionPool.h"
+#include "JsonWriter.h"
+
+/**
+ * @class StockStream
+ * @brief One page of stocks with their latest quotes, written as JSON while
+ *        the query is still being stepped.
+ *
+ * Rows come in symbol order starting after a cursor (the last symbol of the
+ * previous page). Only the requested fields are selected. The body is
+ *   {"stocks":[{...},...],"nextCursor":"MSFT"}
+ * with a null nextCursor on the last page.
+ *
+ * The statement lives on the calling thread's pooled connection, so a stream
+ * must be read and destroyed on the thread that opened it. httplib runs a
+ * response's content provider on the thread that ran its handler. While a
+ * stream is open it holds a read transaction, so pages are kept short.
+ */
+class StockStream {
+public:
+    static constexpr size_t FIELD_COUNT = 11;
+    static constexpr uint32_t ALL_FIELDS = (uint32_t(1) << FIELD_COUNT) - 1;
+
+    /**
+     * @brief Parses a comma-separated list of /stocks keys ("Symbol,Price")
+     *        into a field mask.
+     * @return false if the list is empty or names an unknown field.
+     */
+    static bool parseFields(const std::string& list, uint32_t& fields);
+
+    /**
+     * @brief Runs the query and reads its first row. Check ok() afterwards.
+     * @param fields Mask from parseFields(), or ALL_FIELDS.
+     * @param after Cursor; rows start at the first symbol greater than it.
+     * @param limit Rows per page, at least 1.
+     */
+    StockStream(Connection& conn, uint32_t fields, const std::string& after, size_t limit);
+
+    StockStream(const StockStream&) = delete;
+    StockStream& operator=(const StockStream&) = delete;
+
+    bool ok() const { return !failed; }
+    bool done() const { return finished; }
+
+    /**
+     * @brief Returns the next piece of the body, roughly 16 KB of rows. The
+     *        last piece closes the document and sets done(). The returned
+     *        text is overwritten by the next call.
+     */
+    const std::string& next();
+
+private:
+    bool step();
+
+    Connection& conn;
+    Statement stmt;
+    uint8_t columns[FIELD_COUNT]; // field written from each selected column
+    int column_count = 0;
+    int symbol_column = 0;
+    size_t limit;
+    size_t rows = 0;
+    bool has_row = false;
+    bool failed = false;
+    bool finished = false;
+    std::string cursor; // symbol of the last row in the page
+    std::string chunk;
+    JsonWriter writer{chunk};
+};
+
+#endif // STOCKSTREAM_H
@@ -0,0 +1,56 @@
+#include "SymbolTable.h"
+#include <mutex>
+#include <stdexcept>
+
+SymbolTable& SymbolTable::global() {
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable::SymbolTable() : chunks(new std::atomic<std::string*>[MAX_CHUNKS]) {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SymbolTable::~SymbolTable() {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+SymbolId SymbolTable::intern(std::string_view symbol) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = ids.find(symbol);
+        if (it != ids.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = ids.find(symbol);
+    if (it != ids.end()) return it->second;
+
+    size_t id = count.load(std::memory_order_relaxed);
+    size_t chunk = id >> CHUNK_BITS;
+    if (chunk >= MAX_CHUNKS) {
+        throw std::length_error("symbol table is full");
+    }
+    std::string* names = chunks[chunk].load(std::memory_order_relaxed);
+    if (names == nullptr) {
+        names = new std::string[CHUNK_SIZE];
+        chunks[chunk].store(names, std::memory_order_release);
+    }
+    std::string& name = names[id & (CHUNK_SIZE - 1)];
+    name.assign(symbol.data(), symbol.size());
+    ids.emplace(std::string_view(name), static_cast<SymbolId>(id));
+    count.store(id + 1, std::memory_order_release);
+    return static_cast<SymbolId>(id);
+}
+
+bool SymbolTable::find(std::string_view symbol, SymbolId& id) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = ids.find(symbol);
+    if (it == ids.end()) return false;
+    id = it->second;
+    return true;
+}
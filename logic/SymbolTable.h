@@ -0,0 +1,68 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// Dense id of an interned ticker symbol. Ids start at 0 and are never reused.
+using SymbolId = uint32_t;
+
+/**
+ * @class SymbolTable
+ * @brief Process-wide dictionary mapping ticker strings to dense SymbolIds.
+ *
+ * Interning takes a lock; looking up the name of an id does not. Names are
+ * stored in fixed-size chunks that never move, so a reference returned by
+ * name() stays valid for the life of the process.
+ */
+class SymbolTable {
+public:
+    /**
+     * @brief The table shared by the whole process.
+     */
+    static SymbolTable& global();
+
+    SymbolTable();
+    ~SymbolTable();
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    /**
+     * @brief Returns the id of a symbol, assigning the next id if it is new.
+     */
+    SymbolId intern(std::string_view symbol);
+
+    /**
+     * @brief Looks up a symbol without interning it.
+     * @return false if the symbol has never been interned.
+     */
+    bool find(std::string_view symbol, SymbolId& id) const;
+
+    /**
+     * @brief The ticker for an id returned by intern().
+     */
+    const std::string& name(SymbolId id) const {
+        return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];
+    }
+
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    static constexpr unsigned CHUNK_BITS = 12;
+    static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static constexpr size_t MAX_CHUNKS = 4096;
+
+    mutable std::shared_mutex mtx;
+    // Keys view the strings held in chunks.
+    std::unordered_map<std::string_view, SymbolId> ids;
+    std::unique_ptr<std::atomic<std::string*>[]> chunks;
+    std::atomic<size_t> count{0};
+};
+
+#endif // SYMBOLTABLE_H
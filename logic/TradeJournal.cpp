@@ -0,0 +1,264 @@
+#include "TradeJournal.h"
+#include <cstring>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'T', 'K', 'J', 'R', 'N', 'L', '1'};
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t RECORD_SIZE = 64;
+constexpr size_t GROW_RECORDS = 1 << 16; // 4 MiB at a time
+
+// On-disk record layout. Every field is naturally aligned, so there is no
+// implicit padding; integers are stored in host (little-endian) order.
+struct DiskRecord {
+    uint64_t seq;
+    int64_t price_micros;
+    int64_t order_id;
+    int32_t user_id;
+    int32_t quantity;
+    int32_t remaining;
+    uint8_t sell;
+    uint8_t symbol_length;
+    uint8_t reserved[2];
+    char symbol[20];
+    uint32_t crc; // over every byte before it
+};
+static_assert(sizeof(DiskRecord) == RECORD_SIZE, "journal record must be 64 bytes");
+
+struct DiskHeader {
+    char magic[8];
+    uint64_t first_seq;
+    uint8_t reserved[48];
+};
+static_assert(sizeof(DiskHeader) == HEADER_SIZE, "journal header must be 64 bytes");
+
+const std::array<uint32_t, 256>& crcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+// CRC-32 (IEEE), as used by zlib.
+uint32_t crc32(const uint8_t* data, size_t length) {
+    const auto& table = crcTable();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+uint32_t recordCrc(const DiskRecord& record) {
+    return crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(DiskRecord, crc));
+}
+
+size_t offsetOf(uint64_t index) {
+    return HEADER_SIZE + index * RECORD_SIZE;
+}
+
+} // namespace
+
+bool TradeJournal::fail(const std::string& what) {
+    last_error = what;
+    return false;
+}
+
+bool TradeJournal::writeHeader(uint64_t seq) {
+    DiskHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.first_seq = seq;
+    std::memcpy(file.data(), &header, sizeof(header));
+    first_seq = next_seq = seq;
+    flushed_offset = 0;
+    return file.flush(0, HEADER_SIZE) || fail(file.error());
+}
+
+bool TradeJournal::open(const std::string& journal_path, uint64_t new_first_seq) {
+    std::lock_guard<std::mutex> flush_lock(flush_mtx);
+    std::lock_guard<std::mutex> lock(mtx);
+    path = journal_path;
+    if (!file.open(path, offsetOf(GROW_RECORDS))) return fail(file.error());
+
+    DiskHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        bool empty = true;
+        for (size_t i = 0; i < HEADER_SIZE && empty; ++i) empty = file.data()[i] == 0;
+        if (!empty) return fail(path + " is not a trade journal");
+        return writeHeader(new_first_seq);
+    }
+
+    // Keep the longest prefix of intact, consecutive records.
+    first_seq = header.first_seq;
+    uint64_t count = 0;
+    while (offsetOf(count + 1) <= file.size()) {
+        DiskRecord record;
+        std::memcpy(&record, file.data() + offsetOf(count), RECORD_SIZE);
+        if (record.seq != first_seq + count || record.crc != recordCrc(record)) break;
+        ++count;
+    }
+    next_seq = first_seq + count;
+
+    // Clear everything past the intact prefix. A record that reached disk
+    // after a torn one must not come back once new appends fill the gap.
+    size_t end = offsetOf(count);
+    for (size_t i = end; i < file.size(); ++i) {
+        if (file.data()[i] != 0) {
+            std::memset(file.data() + end, 0, file.size() - end);
+            if (!file.flush(end, file.size() - end)) return fail(file.error());
+            break;
+        }
+    }
+    flushed_offset = end;
+    return true;
+}
+
+bool TradeJournal::append(std::vector<JournalRecord>& records) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!file.isOpen()) return fail("journal is not open");
+
+    auto needed = [&]() { return offsetOf(next_seq - first_seq + records.size()); };
+    if (needed() > file.size()) {
+        // Growing remaps the file, so it waits for any flush in progress.
+        lock.unlock();
+        std::lock_guard<std::mutex> flush_lock(flush_mtx);
+        lock.lock();
+        if (!file.isOpen()) return fail("journal is not open");
+        if (needed() > file.size()) {
+            size_t grown = file.size() + GROW_RECORDS * RECORD_SIZE;
+            if (!file.resize(grown > needed() ? grown : needed())) return fail(file.error());
+        }
+    }
+
+    for (JournalRecord& record : records) {
+        if (record.symbol.size() > JournalRecord::MAX_SYMBOL) return fail("symbol too long: " + record.symbol);
+    }
+    for (JournalRecord& record : records) {
+        record.seq = next_seq;
+        DiskRecord disk{};
+        disk.seq = record.seq;
+        disk.price_micros = record.price_micros;
+        disk.order_id = record.order_id;
+        disk.user_id = record.user_id;
+        disk.quantity = record.quantity;
+        disk.remaining = record.remaining;
+        disk.sell = record.sell ? 1 : 0;
+        disk.symbol_length = static_cast<uint8_t>(record.symbol.size());
+        std::memcpy(disk.symbol, record.symbol.data(), record.symbol.size());
+        disk.crc = recordCrc(disk);
+        std::memcpy(file.data() + offsetOf(next_seq - first_seq), &disk, RECORD_SIZE);
+        ++next_seq;
+    }
+    return true;
+}
+
+void TradeJournal::read(uint64_t from, size_t max, std::vector<JournalRecord>& out) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (from < first_seq) from = first_seq;
+    for (uint64_t seq = from; seq < next_seq && max > 0; ++seq, --max) {
+        DiskRecord disk;
+        std::memcpy(&disk, file.data() + offsetOf(seq - first_seq), RECORD_SIZE);
+        JournalRecord record;
+        record.seq = disk.seq;
+        record.user_id = disk.user_id;
+        record.sell = disk.sell != 0;
+        record.quantity = disk.quantity;
+        record.price_micros = disk.price_micros;
+        record.order_id = disk.order_id;
+        record.remaining = disk.remaining;
+        record.symbol.assign(disk.symbol, disk.symbol_length);
+        out.push_back(std::move(record));
+    }
+}
+
+bool TradeJournal::flush() {
+    // Appends go on while the range is written out; only calls that move the
+    // mapping wait for it.
+    std::lock_guard<std::mutex> flush_lock(flush_mtx);
+    size_t start = 0;
+    size_t end = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        end = offsetOf(next_seq - first_seq);
+        start = flushed_offset < HEADER_SIZE ? HEADER_SIZE : flushed_offset;
+    }
+    if (end <= start) return true;
+    bool flushed = file.flush(start, end - start);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!flushed) return fail(file.error());
+    flushed_offset = end;
+    return true;
+}
+
+bool TradeJournal::reset(uint64_t seq) {
+    std::lock_guard<std::mutex> flush_lock(flush_mtx);
+    std::lock_guard<std::mutex> lock(mtx);
+    return resetLocked(seq);
+}
+
+bool TradeJournal::resetLocked(uint64_t seq) {
+    if (!file.isOpen()) return fail("journal is not open");
+    if (!file.resize(offsetOf(GROW_RECORDS))) return fail(file.error());
+    // The new first sequence number goes to disk before the old records are
+    // cleared. Every old record is numbered below it, so after a crash in
+    // between they read as an empty journal rather than as one that starts
+    // before the database's checkpoint.
+    if (!writeHeader(seq)) return false;
+    std::memset(file.data() + HEADER_SIZE, 0, file.size() - HEADER_SIZE);
+    return file.flush(HEADER_SIZE, file.size() - HEADER_SIZE) || fail(file.error());
+}
+
+bool TradeJournal::discardBefore(uint64_t seq) {
+    std::lock_guard<std::mutex> flush_lock(flush_mtx);
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!file.isOpen()) return fail("journal is not open");
+    if (seq <= first_seq) return true;
+    if (seq >= next_seq) return resetLocked(seq);
+
+    // Copy the records that stay into a new file and swap it in, so a crash
+    // part way through leaves either the old journal or the new one.
+    uint64_t kept = next_seq - seq;
+    std::string temp_path = path + ".tmp";
+    std::remove(temp_path.c_str());
+    {
+        MappedFile temp;
+        size_t size = offsetOf(kept > GROW_RECORDS ? kept : GROW_RECORDS);
+        if (!temp.open(temp_path, size)) return fail(temp.error());
+
+        DiskHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.first_seq = seq;
+        std::memcpy(temp.data(), &header, sizeof(header));
+        std::memcpy(temp.data() + HEADER_SIZE, file.data() + offsetOf(seq - first_seq), kept * RECORD_SIZE);
+        if (!temp.flush(0, offsetOf(kept))) return fail(temp.error());
+    }
+
+    file.close();
+    std::string error;
+    bool replaced = MappedFile::replace(temp_path, path, error);
+    if (!file.open(path, offsetOf(GROW_RECORDS))) return fail(file.error());
+    if (!replaced) return fail(error);
+
+    first_seq = seq;
+    flushed_offset = offsetOf(kept);
+    return true;
+}
+
+uint64_t TradeJournal::firstSeq() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return first_seq;
+}
+
+uint64_t TradeJournal::nextSeq() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return next_seq;
+}
@@ -0,0 +1,107 @@
+#ifndef TRADEJOURNAL_H
+#define TRADEJOURNAL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include "MappedFile.h"
+
+/**
+ * @struct JournalRecord
+ * @brief One executed trade as stored in the journal.
+ *
+ * Symbols are stored as text rather than SymbolIds because ids are only
+ * stable within one process.
+ */
+struct JournalRecord {
+    static constexpr size_t MAX_SYMBOL = 19;
+
+    uint64_t seq = 0;
+    int user_id = 0;
+    bool sell = false;
+    int quantity = 0;
+    int64_t price_micros = 0;
+    int64_t order_id = 0; // 0 for direct trades; set for matching-engine fills
+    int remaining = 0;    // order quantity left after a fill
+    std::string symbol;
+};
+
+/**
+ * @class TradeJournal
+ * @brief Append-only, memory-mapped, checksummed log of executed trades.
+ *
+ * The file is a 64-byte header followed by fixed 64-byte records, each with
+ * a CRC-32 over its contents and a sequence number one above the last.
+ * Appending copies the record into the mapping, so it survives a crash of
+ * the process as soon as append() returns. flush() forces the written range
+ * to disk so it also survives a crash of the machine. On open, the file is
+ * scanned and anything after the last intact record is discarded.
+ */
+class TradeJournal {
+public:
+    TradeJournal() = default;
+
+    TradeJournal(const TradeJournal&) = delete;
+    TradeJournal& operator=(const TradeJournal&) = delete;
+
+    /**
+     * @brief Opens or creates the journal and recovers its intact prefix.
+     * @param first_seq Sequence number of the first record if the file is new.
+     */
+    bool open(const std::string& path, uint64_t first_seq);
+
+    /**
+     * @brief Appends records, assigning their sequence numbers.
+     * @return false if the journal is closed or cannot grow.
+     */
+    bool append(std::vector<JournalRecord>& records);
+
+    /**
+     * @brief Copies up to @p max records starting at sequence @p from.
+     */
+    void read(uint64_t from, size_t max, std::vector<JournalRecord>& out);
+
+    /**
+     * @brief Makes every record appended before the call durable on disk.
+     *
+     * Appends are not blocked while the records are written out, except one
+     * that has to grow the file.
+     */
+    bool flush();
+
+    /**
+     * @brief Starts a new, empty journal whose first record will be @p first_seq.
+     *
+     * Used once everything before @p first_seq is covered by other durable state.
+     */
+    bool reset(uint64_t first_seq);
+
+    /**
+     * @brief Drops every record before @p seq, keeping the rest.
+     *
+     * The remaining records are copied to a new file that replaces the old
+     * one. Used after a snapshot has made the older records redundant.
+     */
+    bool discardBefore(uint64_t seq);
+
+    uint64_t firstSeq();
+    uint64_t nextSeq(); // one past the last appended record
+    const std::string& error() const { return last_error; }
+
+private:
+    bool writeHeader(uint64_t first_seq);
+    bool resetLocked(uint64_t first_seq);
+    bool fail(const std::string& what);
+
+    std::mutex flush_mtx; // held by flush() and by anything that moves the mapping; taken before mtx
+    std::mutex mtx;       // guards everything below
+    std::string path;
+    MappedFile file;
+    uint64_t first_seq = 1;
+    uint64_t next_seq = 1;
+    size_t flushed_offset = 0; // bytes before this are known to be on disk
+    std::string last_error;
+};
+
+#endif // TRADEJOURNAL_H
@@ -0,0 +1,98 @@
+#include "ValuationEngine.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+namespace {
+
+// Bound an overflowing sum or product is clamped to, by the sign it would have had.
+int64_t saturated(bool negative) {
+    return negative ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+}
+
+// Values accounts [first, last). prices covers every SymbolId in the columns.
+void valueAccounts(const PositionColumns& columns, const int64_t* prices,
+                   size_t first, size_t last, AccountValue* out) {
+    const SymbolId* symbols = columns.symbols.data();
+    const int64_t* quantities = columns.quantities.data();
+    const int64_t* costs = columns.costs.data();
+
+    for (size_t account = first; account < last; ++account) {
+        int64_t value = 0;
+        int64_t cost = 0;
+        for (uint32_t i = columns.offsets[account], end = columns.offsets[account + 1]; i < end; ++i) {
+            int64_t price = prices[symbols[i]];
+            // A position too large to mark saturates rather than wrapping
+            // round to a negative value and the bottom of the ranking.
+            int64_t marked;
+            if (__builtin_mul_overflow(quantities[i], price, &marked)) {
+                marked = saturated((quantities[i] < 0) != (price < 0));
+            }
+            // Select rather than branch: unquoted symbols are carried at cost.
+            int64_t held = price > 0 ? marked : costs[i];
+            if (__builtin_add_overflow(value, held, &value)) value = saturated(held < 0);
+            if (__builtin_add_overflow(cost, costs[i], &cost)) cost = saturated(costs[i] < 0);
+        }
+        out[account] = {static_cast<uint32_t>(account), Money::fromMicros(columns.cash[account]),
+                        Money::fromMicros(value), Money::fromMicros(cost)};
+    }
+}
+
+} // namespace
+
+ValuationEngine::ValuationEngine(unsigned threads)
+    : threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+std::shared_ptr<const Valuation> ValuationEngine::mark(std::shared_ptr<const PositionColumns> accounts,
+                                                       const std::vector<int64_t>& prices) {
+    std::lock_guard<std::mutex> lock(mark_mtx);
+    const PositionColumns& columns = *accounts;
+    size_t account_count = columns.user_ids.size();
+
+    // Pad the price vector so every SymbolId in the columns can be gathered
+    // without a bounds check.
+    SymbolId max_symbol = 0;
+    for (SymbolId symbol : columns.symbols) max_symbol = std::max(max_symbol, symbol);
+    std::vector<int64_t> padded(prices);
+    if (padded.size() <= max_symbol) padded.resize(size_t(max_symbol) + 1, 0);
+
+    auto next = std::make_shared<Valuation>();
+    next->accounts = accounts;
+    next->ranked.resize(account_count);
+
+    // Split into account-aligned ranges carrying about the same number of
+    // positions plus accounts.
+    size_t parts = std::min<size_t>(threads, std::max<size_t>(1, account_count / 1024));
+    size_t total = columns.symbols.size() + account_count;
+    std::vector<size_t> bounds{0};
+    for (size_t account = 0; account < account_count && bounds.size() < parts; ++account) {
+        if (columns.offsets[account] + account >= total * bounds.size() / parts) {
+            if (account > bounds.back()) bounds.push_back(account);
+        }
+    }
+    bounds.push_back(account_count);
+
+    std::vector<std::thread> workers;
+    for (size_t part = 1; part + 1 < bounds.size(); ++part) {
+        workers.emplace_back(valueAccounts, std::cref(columns), padded.data(),
+                             bounds[part], bounds[part + 1], next->ranked.data());
+    }
+    valueAccounts(columns, padded.data(), bounds[0], bounds[1], next->ranked.data());
+    for (std::thread& worker : workers) worker.join();
+
+    std::sort(next->ranked.begin(), next->ranked.end(), [&](const AccountValue& a, const AccountValue& b) {
+        if (a.equity() != b.equity()) return a.equity() > b.equity();
+        return columns.user_ids[a.account] < columns.user_ids[b.account];
+    });
+
+    next->version = ++version;
+    next->computed_at = std::chrono::system_clock::now();
+    std::shared_ptr<const Valuation> published = next;
+    std::atomic_store(&latest, published);
+    return published;
+}
+
+std::shared_ptr<const Valuation> ValuationEngine::current() const {
+    return std::atomic_load(&latest);
+}
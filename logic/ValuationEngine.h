@@ -0,0 +1,98 @@
+#ifndef VALUATIONENGINE_H
+#define VALUATIONENGINE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "Money.h"
+#include "SymbolTable.h"
+
+/**
+ * @struct PositionColumns
+ * @brief Every account and open position, laid out column by column.
+ *
+ * Account a owns positions [offsets[a], offsets[a + 1]). Amounts are Money
+ * micro-units held as plain integers so the valuation loop stays branch-free.
+ */
+struct PositionColumns {
+    // One entry per account, ordered by user id
+    std::vector<int> user_ids;
+    std::vector<std::string> usernames;
+    std::vector<int64_t> cash;
+    std::vector<uint32_t> offsets; // size() == user_ids.size() + 1
+
+    // One entry per position, grouped by account
+    std::vector<SymbolId> symbols;
+    std::vector<int64_t> quantities;
+    std::vector<int64_t> costs;
+};
+
+/**
+ * @struct AccountValue
+ * @brief One account marked to market.
+ */
+struct AccountValue {
+    uint32_t account; // index into PositionColumns
+    Money cash;
+    Money market_value;
+    Money cost_basis;
+
+    Money equity() const { return Money::saturatingAdd(cash, market_value); }
+    Money unrealizedPnl() const { return Money::saturatingSubtract(market_value, cost_basis); }
+};
+
+/**
+ * @struct Valuation
+ * @brief Result of one mark-to-market pass, ranked by equity (highest first).
+ */
+struct Valuation {
+    uint64_t version;
+    std::chrono::system_clock::time_point computed_at;
+    std::shared_ptr<const PositionColumns> accounts;
+    std::vector<AccountValue> ranked;
+};
+
+/**
+ * @class ValuationEngine
+ * @brief Marks every account to a price vector in one parallel pass.
+ *
+ * Positions are split across worker threads in contiguous, account-aligned
+ * ranges of roughly equal size. Each thread gathers prices by SymbolId and
+ * sums per account; a position whose symbol has no price is carried at cost.
+ * The latest result is published the same way as QuoteCache snapshots, so
+ * readers never block on a pass in progress.
+ */
+class ValuationEngine {
+public:
+    /**
+     * @param threads Worker threads per pass; 0 uses the hardware concurrency.
+     */
+    explicit ValuationEngine(unsigned threads = 0);
+
+    ValuationEngine(const ValuationEngine&) = delete;
+    ValuationEngine& operator=(const ValuationEngine&) = delete;
+
+    /**
+     * @brief Values all accounts and publishes the ranked result.
+     * @param prices Last price per SymbolId in micro-units; 0 or missing means no quote.
+     * @return The valuation now being served.
+     */
+    std::shared_ptr<const Valuation> mark(std::shared_ptr<const PositionColumns> accounts,
+                                          const std::vector<int64_t>& prices);
+
+    /**
+     * @brief Returns the latest valuation, or nullptr before the first mark().
+     */
+    std::shared_ptr<const Valuation> current() const;
+
+private:
+    unsigned threads;
+    std::shared_ptr<const Valuation> latest;
+    std::mutex mark_mtx; // serializes passes only
+    uint64_t version = 0;
+};
+
+#endif // VALUATIONENGINE_H
@@ -2,33 +2,303 @@
 #define _WIN32_WINNT 0x0A00
 
 #define CPPHTTPLIB_OPENSSL_SUPPORT
+// Room for stream subscribers reconnecting all at once; the default is 5.
+#define CPPHTTPLIB_LISTEN_BACKLOG 1024
 #include "httplib.h"
 #include "json.hpp"
 #include "DatabaseManager.h"
+#include "MatchingEngine.h"
+#include "QuoteCache.h"
+#include "QuoteStream.h"
+#include "ValuationEngine.h"
+#include "EventLoopServer.h"
+#include "ServerConfig.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "JsonWriter.h"
+#include "ResponseEncoding.h"
+#include "SessionTokens.h"
 #include "User.h"
-#include <iostream>
 #include <memory>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+#include <atomic>
 
 // Use nlohmann::json for convenience
 using json = nlohmann::json;
 
+const char* CONFIG_FILE = "server_config.json"; // overridden by the first command-line argument
 const char* DB_FILE = "stock_portfolio.db";
+const char* QUOTES_CSV_FILE = "market_data.csv"; // written by `python stockdb.py --csv`
+const char* JOURNAL_FILE = "trades.journal"; // one file per account shard (trades.0.journal, ...); empty to write trades straight to the database
+const char* SNAPSHOT_FILE = "state.snapshot"; // journaled mode only; empty to disable
+const auto SNAPSHOT_INTERVAL = std::chrono::minutes(5);
+
+// Reads an amount sent either as a JSON number or as a decimal string.
+// Strings are parsed exactly; numbers are rounded to the nearest micro-unit.
+Money parseMoney(const json& value) {
+    if (value.is_string()) {
+        Money money;
+        if (!Money::parse(value.get<std::string>(), money)) {
+            throw std::invalid_argument("Invalid amount: " + value.get<std::string>());
+        }
+        return money;
+    }
+    Money money;
+    if (!Money::fromDouble(value.get<double>(), money)) {
+        throw std::invalid_argument("Invalid amount: " + value.dump());
+    }
+    return money;
+}
+
+// Verifies the token of an "Authorization: Bearer <token>" header.
+bool bearerSession(const SessionTokens& sessions, const httplib::Request& req, Session& session) {
+    const std::string& header = req.get_header_value("Authorization");
+    const std::string scheme = "Bearer ";
+    return header.compare(0, scheme.size(), scheme) == 0 &&
+           sessions.verify(std::string_view(header).substr(scheme.size()), session);
+}
+
+// Checks that a request acting for @p userId carries that user's session.
+// On failure the 401 or 403 response is already set.
+bool authorize(const SessionTokens& sessions, const httplib::Request& req, httplib::Response& res, int userId) {
+    Session session;
+    if (!bearerSession(sessions, req, session)) {
+        res.status = 401; // Unauthorized
+        res.set_header("WWW-Authenticate", "Bearer");
+        json response_json = {{"success", false}, {"message", "Missing or expired session; log in again."}};
+        res.set_content(response_json.dump(), "application/json");
+        return false;
+    }
+    if (session.user_id != userId) {
+        res.status = 403; // Forbidden
+        json response_json = {{"success", false}, {"message", "Session does not belong to this user."}};
+        res.set_content(response_json.dump(), "application/json");
+        return false;
+    }
+    return true;
+}
+
+// Checks an "Authorization: Bearer <token>" header against the configured
+// admin token, in time independent of where they differ. With no admin
+// token configured every request is refused. On failure the 401 or 403
+// response is already set.
+bool authorizeAdmin(const std::string& adminToken, const httplib::Request& req, httplib::Response& res) {
+    if (adminToken.empty()) {
+        res.status = 403; // Forbidden
+        json response_json = {{"success", false}, {"message", "Admin endpoints are disabled; set adminToken to enable them."}};
+        res.set_content(response_json.dump(), "application/json");
+        return false;
+    }
+    const std::string& header = req.get_header_value("Authorization");
+    const std::string scheme = "Bearer ";
+    unsigned char diff = header.size() == scheme.size() + adminToken.size() ? 0 : 1;
+    if (diff == 0) {
+        for (size_t i = 0; i < header.size(); ++i) {
+            char expected = i < scheme.size() ? scheme[i] : adminToken[i - scheme.size()];
+            diff |= static_cast<unsigned char>(header[i] ^ expected);
+        }
+    }
+    if (diff != 0) {
+        res.status = 401; // Unauthorized
+        res.set_header("WWW-Authenticate", "Bearer");
+        json response_json = {{"success", false}, {"message", "Missing or invalid admin token."}};
+        res.set_content(response_json.dump(), "application/json");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    if (!config.load(argc > 1 ? argv[1] : CONFIG_FILE)) {
+        Logger::fatal("Could not load server config. Exiting.");
+        return 1;
+    }
+    Logger::global().setLevel(config.log_level);
 
-int main() {
     // Initialize the database manager and server
     DatabaseManager dbManager(DB_FILE);
     if (!dbManager.initializeDatabase()) {
-        std::cerr << "[FATAL] Could not initialize database. Exiting." << std::endl;
+        Logger::fatal("Could not initialize database. Exiting.");
+        return 1;
+    }
+    if (*JOURNAL_FILE && !dbManager.openJournal(JOURNAL_FILE, config.account_shards)) {
+        Logger::fatal("Could not open trade journal. Exiting.");
         return 1;
     }
     
-    httplib::Server svr;
+    // Rebuild the order books from pending orders, then seed last prices
+    MatchingEngine engine;
+    std::vector<OrderRequest> pendingOrders;
+    dbManager.loadPendingOrders(pendingOrders);
+    for (const auto& order : pendingOrders) {
+        std::vector<Fill> fills;
+        std::string error;
+        engine.submit(order, fills, error);
+    }
+
+    // Funds and shares are checked when an order is placed but not held for
+    // it, so a fill the account can no longer cover is refused and what is
+    // left of its order canceled. Fills that could not be saved go back on
+    // the book. Returns false if any could not be saved.
+    auto settleFills = [&](const std::vector<Fill>& fills, std::vector<Fill>& refused) {
+        std::vector<Fill> failed;
+        dbManager.recordFills(fills, refused, failed);
+        for (const Fill& fill : refused) {
+            Logger::warn("Canceling order {}: account {} no longer covers it", fill.order_id, fill.user_id);
+            engine.cancel(fill.order_id, fill.user_id);
+            dbManager.updateOrderStatus(fill.order_id, "canceled");
+        }
+        if (!failed.empty()) {
+            Logger::error("Failed to record {} fills; returning them to the book", failed.size());
+            engine.restore(failed);
+        }
+        return failed.empty();
+    };
+
+    // Resting orders are matched once against each quote. Latest quotes at or
+    // before the checkpoint only set last prices; newer ones are matched and
+    // the checkpoint moved past them.
+    int64_t matchedQuoteId = 0;
+    dbManager.getMatchCheckpoint(matchedQuoteId);
+    auto matchNewQuotes = [&](const std::vector<Quote>& quotes) {
+        std::vector<Fill> fills;
+        int64_t newest = matchedQuoteId;
+        for (const auto& quote : quotes) {
+            if (quote.id > matchedQuoteId) {
+                engine.onMarketData(quote.symbol, quote.price, quote.volume, fills);
+                newest = std::max(newest, quote.id);
+            } else {
+                engine.setLastPrice(quote.symbol, quote.price);
+            }
+        }
+        // Unsaved fills leave the checkpoint where it is, so a restart matches
+        // these quotes again.
+        std::vector<Fill> refused;
+        if (!settleFills(fills, refused)) return;
+        if (newest != matchedQuoteId && dbManager.setMatchCheckpoint(newest)) {
+            matchedQuoteId = newest;
+        }
+    };
+
+    std::vector<Quote> quotes;
+    dbManager.getLatestQuotes(quotes);
+    matchNewQuotes(quotes);
+    Logger::info("Restored {} resting orders", engine.restingOrderCount());
+
+    // /stocks is served from a pre-rendered snapshot, rebuilt only on ingest
+    QuoteCache quoteCache;
+    auto refreshQuotes = [&]() {
+        std::string body;
+        dbManager.writeAllStocksJson(body);
+        return quoteCache.publish(std::move(body));
+    };
+    try {
+        refreshQuotes();
+    } catch (const std::exception& e) {
+        Logger::warn("Could not build initial quote snapshot: {}", e.what());
+    }
+
+    // /quotes/stream pushes each ingest's changed quotes to subscribers
+    QuoteStream quoteStream(config.stream_queue_bytes, config.max_stream_subscribers);
+    quoteStream.publish(quotes);
+
+    // /login and /signin issue signed session tokens; other endpoints acting
+    // for a user verify them without touching the database
+    SessionTokens sessions(config.session_secret, std::chrono::seconds(config.session_ttl_sec));
+
+    // /leaderboard is served from the last batch valuation of every account.
+    // In journaled mode the same scan is saved as a snapshot for the next start.
+    bool snapshots = *JOURNAL_FILE && *SNAPSHOT_FILE;
+    ValuationEngine valuationEngine;
+    auto markAccounts = [&](std::shared_ptr<PositionColumns> accounts, const std::vector<Quote>& quotes) {
+        std::vector<int64_t> prices(SymbolTable::global().size(), 0);
+        for (const auto& quote : quotes) {
+            prices[quote.symbol] = quote.price.getMicros();
+        }
+        valuationEngine.mark(accounts, prices);
+    };
+    auto revalueAccounts = [&]() {
+        auto accounts = std::make_shared<PositionColumns>();
+        std::vector<Quote> quotes;
+        bool loaded = snapshots
+            ? dbManager.writeSnapshot(SNAPSHOT_FILE, *accounts, quotes)
+            : dbManager.loadPositionColumns(*accounts) && dbManager.getLatestQuotes(quotes);
+        if (!loaded) {
+            Logger::warn("Could not load accounts for valuation");
+            return;
+        }
+        markAccounts(accounts, quotes);
+    };
+    // A snapshot gives a first ranking, at the prices it was taken at,
+    // without scanning the database; the background thread then brings it
+    // up to date straight away.
+    auto snapshotAccounts = std::make_shared<PositionColumns>();
+    std::vector<Quote> snapshotQuotes;
+    bool fromSnapshot = snapshots && dbManager.openSnapshot(SNAPSHOT_FILE, *snapshotAccounts, snapshotQuotes);
+    if (fromSnapshot) {
+        markAccounts(snapshotAccounts, snapshotQuotes);
+    } else {
+        revalueAccounts();
+    }
+
+    std::mutex snapshotMtx;
+    std::condition_variable snapshotCv;
+    bool stopping = false;
+    std::thread snapshotter([&, refresh = fromSnapshot]() mutable {
+        std::unique_lock<std::mutex> lock(snapshotMtx);
+        while (refresh || !snapshotCv.wait_for(lock, SNAPSHOT_INTERVAL, [&]() { return stopping; })) {
+            refresh = false;
+            lock.unlock();
+            revalueAccounts();
+            lock.lock();
+        }
+    });
+
+    // After each ingest: match resting orders against the new quotes, push
+    // the changes to stream subscribers, then republish the /stocks snapshot
+    // and revalue every account. Runs on the ingest thread.
+    dbManager.setIngestCompletionHandler([&](const IngestJob&) {
+        std::vector<Quote> quotes;
+        dbManager.getLatestQuotes(quotes);
+        matchNewQuotes(quotes);
+        quoteStream.publish(quotes);
+        try {
+            refreshQuotes();
+        } catch (const std::exception& e) {
+            Logger::warn("Could not refresh quote snapshot: {}", e.what());
+        }
+        revalueAccounts();
+    });
+
+    std::unique_ptr<httplib::Server> server;
+    if (config.event_loop) {
+        server = std::make_unique<EventLoopServer>(config.threads, config.max_queued_requests);
+    } else {
+        server = std::make_unique<httplib::Server>();
+        server->new_task_queue = [&config] {
+            return new httplib::ThreadPool(config.threads, config.max_queued_requests);
+        };
+    }
+    httplib::Server& svr = *server;
+    svr.set_keep_alive_timeout(config.keep_alive_timeout_sec);
+    svr.set_keep_alive_max_count(config.keep_alive_max_count);
+    svr.set_read_timeout(config.read_timeout_sec);
+    svr.set_write_timeout(config.write_timeout_sec);
+    // Responses go out as a header write then a body write; with Nagle on, the
+    // body waits for the client's delayed ACK (~40 ms) on keep-alive connections.
+    svr.set_tcp_nodelay(true);
 
     // --- API Endpoints ---
 
     // POST /login
     svr.Post("/login", [&](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "[INFO] /login endpoint hit" << std::endl;
+        Logger::info("/login endpoint hit");
         res.set_header("Access-Control-Allow-Origin", "*");
         try {
             auto j = json::parse(req.body);
@@ -37,10 +307,14 @@ int main() {
             int userId = -1;
 
             if (dbManager.validateUser(username, password, userId)) {
+                Session session;
+                std::string token = sessions.issue(userId, session);
                 json response_json = {
                     {"success", true},
                     {"userId", userId},
-                    {"username", username}
+                    {"username", username},
+                    {"token", token},
+                    {"expiresAt", session.expires_at}
                 };
                 res.set_content(response_json.dump(), "application/json");
             } else {
@@ -57,7 +331,7 @@ int main() {
 
     //POST /signin
     svr.Post("/signin", [&](const httplib::Request& req, httplib::Response& res){
-        std::cout << "[INFO] /signin endpoint hit" << std::endl;
+        Logger::info("/signin endpoint hit");
         res.set_header("Access-Control-Allow-Origin", "*");
         try {
             auto j = json::parse(req.body);
@@ -67,10 +341,14 @@ int main() {
             int userId = -1;
 
             if (dbManager.addUser(username, password, email, userId)) {
+                Session session;
+                std::string token = sessions.issue(userId, session);
                 json response_json = {
                     {"success", true},
                     {"userId", userId},
-                    {"username", username}
+                    {"username", username},
+                    {"token", token},
+                    {"expiresAt", session.expires_at}
                 };
                 res.set_content(response_json.dump(), "application/json");
             } else {
@@ -85,28 +363,79 @@ int main() {
         }
     });
 
+    // POST /logout with the session's bearer token
+    svr.Post("/logout", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger::info("/logout endpoint hit");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        Session session;
+        if (!bearerSession(sessions, req, session)) {
+            res.status = 401; // Unauthorized
+            json response_json = {{"success", false}, {"message", "Missing or expired session."}};
+            res.set_content(response_json.dump(), "application/json");
+            return;
+        }
+        sessions.revoke(session);
+        json response_json = {{"success", true}};
+        res.set_content(response_json.dump(), "application/json");
+    });
+
     // GET /portfolio/<userId>
     svr.Get(R"(/portfolio/(\d+))", [&](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "[INFO] /portfolio endpoint hit" << std::endl;
+        Logger::info("/portfolio endpoint hit");
         res.set_header("Access-Control-Allow-Origin", "*");
         try {
             int userId = std::stoi(req.matches[1]);
+            if (!authorize(sessions, req, res, userId)) return;
             Portfolio portfolio;
             dbManager.loadPortfolio(userId, portfolio);
+            res.set_header("Vary", "Accept");
 
-            json portfolio_json;
-            portfolio_json["fundBalance"] = portfolio.getFundBalance();
-            json stocks_json = json::array();
+            Encoding encoding = negotiateEncoding(req.get_header_value("Accept"));
+            if (encoding != Encoding::Json) {
+                json stocks = json::array();
+                for (const auto& stock : portfolio.getStocks()) {
+                    Money price = stock.getPurchasePrice();
+                    engine.getLastPrice(stock.getSymbolId(), price);
+                    stocks.push_back({
+                        {"purchase_price", price.toDouble()},
+                        {"quantity", stock.getQuantity()},
+                        {"symbol", stock.getSymbol()}
+                    });
+                }
+                json response_json = {{"fundBalance", portfolio.getFundBalance().toDouble()}, {"stocks", stocks}};
+                std::string body;
+                encodeDocument(response_json, encoding, body);
+                res.set_content(std::move(body), contentType(encoding));
+                return;
+            }
+
+            // Serialized straight into a per-thread buffer; keys in the
+            // order json::dump() used to sort them into.
+            thread_local std::string body;
+            body.clear();
+            JsonWriter writer(body);
+            writer.beginObject();
+            writer.key("\"fundBalance\":");
+            writer.value(portfolio.getFundBalance());
+            writer.key("\"stocks\":");
+            writer.beginArray();
             for (const auto& stock : portfolio.getStocks()) {
-                stocks_json.push_back({
-                    {"symbol", stock->getSymbol()},
-                    {"quantity", stock->getQuantity()},
-                    {"purchase_price", stock->getPurchasePrice()}
-                });
+                // Priced at the last trade, as the database-backed load does
+                Money price = stock.getPurchasePrice();
+                engine.getLastPrice(stock.getSymbolId(), price);
+                writer.beginObject();
+                writer.key("\"purchase_price\":");
+                writer.value(price);
+                writer.key("\"quantity\":");
+                writer.value(stock.getQuantity());
+                writer.key("\"symbol\":");
+                writer.value(stock.getSymbol());
+                writer.endObject();
             }
-            portfolio_json["stocks"] = stocks_json;
+            writer.endArray();
+            writer.endObject();
 
-            res.set_content(portfolio_json.dump(), "application/json");
+            res.set_content(body.data(), body.size(), "application/json");
 
         } catch (const std::exception& e) {
             res.status = 500;
@@ -117,7 +446,7 @@ int main() {
 
     // POST /transaction
     svr.Post("/transaction", [&](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "[INFO] /transaction endpoint hit" << std::endl;
+        Logger::info("/transaction endpoint hit");
         res.set_header("Access-Control-Allow-Origin", "*");
         try {
             auto j = json::parse(req.body);
@@ -125,20 +454,33 @@ int main() {
             std::string type = j["type"];
             std::string symbol = j["symbol"];
             int quantity = j["quantity"];
-            double price = j["price"];
+            Money price = parseMoney(j["price"]);
+            if (!authorize(sessions, req, res, userId)) return;
+            if (quantity <= 0 || price <= Money()) {
+                throw std::invalid_argument("quantity and price must be positive");
+            }
 
-            Portfolio portfolio;
-            dbManager.loadPortfolio(userId, portfolio);
-            
-            bool success = false;
-            if (type == "buy") {
-                success = portfolio.buyStock(symbol, quantity, price);
-            } else if (type == "sell") {
-                success = portfolio.sellStock(symbol, quantity, price);
+            SymbolId symbolId;
+            if (!SymbolTable::global().find(symbol, symbolId)) {
+                json response_json = {{"success", false}, {"message", "Unknown symbol: " + symbol}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+
+            // Checked and applied on the account's shard, in order with its other trades
+            TradeResult result = TradeResult::Rejected;
+            if (type == "buy" || type == "sell") {
+                result = dbManager.executeTrade(userId, {symbolId, type, quantity, price});
+            }
+
+            if (result == TradeResult::Failed) {
+                res.status = 500;
+                json response_json = {{"success", false}, {"message", "Failed to save transaction."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
             }
 
-            if (success) {
-                dbManager.savePortfolio(userId, portfolio);
+            if (result == TradeResult::Applied) {
                 json response_json = {{"success", true}};
                 res.set_content(response_json.dump(), "application/json");
             } else {
@@ -153,13 +495,199 @@ int main() {
         }
     });
     
-    // GET /stocks
+    // POST /order
+    svr.Post("/order", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger::info("/order endpoint hit");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        try {
+            auto j = json::parse(req.body);
+            OrderRequest order;
+            order.user_id = j["userId"];
+            std::string symbol = j["symbol"];
+            std::string side = j["side"];
+            std::string type = j.value("type", "market");
+            order.quantity = j["quantity"];
+            if (!authorize(sessions, req, res, order.user_id)) return;
+
+            if (side != "buy" && side != "sell") {
+                throw std::invalid_argument("side must be 'buy' or 'sell'");
+            }
+            if (type != "market" && type != "limit") {
+                throw std::invalid_argument("type must be 'market' or 'limit'");
+            }
+            if (!SymbolTable::global().find(symbol, order.symbol)) {
+                json response_json = {{"success", false}, {"message", "Unknown symbol: " + symbol}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            order.side = side == "buy" ? Side::Buy : Side::Sell;
+            order.type = type == "limit" ? OrderType::Limit : OrderType::Market;
+            if (order.type == OrderType::Limit) {
+                order.limit_price = parseMoney(j["price"]);
+            }
+
+            // Check funds or holdings before the order reaches the book
+            Portfolio portfolio;
+            dbManager.loadPortfolio(order.user_id, portfolio);
+            Money price = order.limit_price;
+            if (order.type == OrderType::Market) {
+                engine.getLastPrice(order.symbol, price);
+            }
+            Money notional;
+            if (!Money::multiply(price, order.quantity, notional)) {
+                throw std::invalid_argument("Order amount out of range");
+            }
+            bool allowed = true;
+            if (order.side == Side::Buy) {
+                allowed = portfolio.getFundBalance() >= notional;
+            } else {
+                allowed = portfolio.getHeldQuantity(order.symbol) >= order.quantity;
+            }
+            if (!allowed) {
+                json response_json = {{"success", false}, {"message", "Order rejected. Check funds or quantity."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+
+            int64_t orderId = 0;
+            if (!dbManager.insertOrder(order, orderId)) {
+                json response_json = {{"success", false}, {"message", "Unknown symbol: " + symbol}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            order.order_id = orderId;
+
+            std::vector<Fill> fills;
+            std::string error;
+            if (!engine.submit(order, fills, error)) {
+                dbManager.updateOrderStatus(orderId, "canceled");
+                json response_json = {{"success", false}, {"orderId", orderId}, {"message", error}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            std::vector<Fill> refused;
+            if (!settleFills(fills, refused)) {
+                // A limit order is back on the book; a market order cannot wait
+                if (order.type == OrderType::Market) dbManager.updateOrderStatus(orderId, "canceled");
+                res.status = 500;
+                json response_json = {{"success", false}, {"orderId", orderId}, {"message", "Failed to save the order's fills."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            if (!refused.empty()) {
+                json response_json = {{"success", false}, {"orderId", orderId}, {"message", "Order rejected. Check funds or quantity."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+
+            int filled = 0;
+            for (const auto& fill : fills) filled += fill.quantity;
+            json response_json = {
+                {"success", true},
+                {"orderId", orderId},
+                {"status", filled == order.quantity ? "completed" : "pending"},
+                {"filledQuantity", filled}
+            };
+            res.set_content(response_json.dump(), "application/json");
+
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json response_json = {{"success", false}, {"message", e.what()}};
+            res.set_content(response_json.dump(), "application/json");
+        }
+    });
+
+    // POST /order/cancel
+    svr.Post("/order/cancel", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger::info("/order/cancel endpoint hit");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        try {
+            auto j = json::parse(req.body);
+            int userId = j["userId"];
+            int64_t orderId = j["orderId"];
+            if (!authorize(sessions, req, res, userId)) return;
+
+            if (engine.cancel(orderId, userId)) {
+                dbManager.updateOrderStatus(orderId, "canceled");
+                json response_json = {{"success", true}};
+                res.set_content(response_json.dump(), "application/json");
+            } else {
+                res.status = 404;
+                json response_json = {{"success", false}, {"message", "No pending order with that id."}};
+                res.set_content(response_json.dump(), "application/json");
+            }
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json response_json = {{"success", false}, {"message", e.what()}};
+            res.set_content(response_json.dump(), "application/json");
+        }
+    });
+
+    // GET /stocks returns the whole snapshot as an array, or in another
+    // encoding if the Accept header asks for one (see ResponseEncoding.h).
+    // GET /stocks?fields=Symbol,Price&limit=N&cursor=C returns one page
+    // ({"stocks": [...], "nextCursor": C}) read straight from the database
+    // and sent chunked as rows are read; pass nextCursor back for the next page.
     svr.Get("/stocks", [&](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "[INFO] /stocks endpoint hit" << std::endl;
+        Logger::info("/stocks endpoint hit");
         res.set_header("Access-Control-Allow-Origin", "*");
+        if (req.has_param("fields") || req.has_param("limit") || req.has_param("cursor")) {
+            try {
+                uint32_t fields = StockStream::ALL_FIELDS;
+                if (req.has_param("fields") && !StockStream::parseFields(req.get_param_value("fields"), fields)) {
+                    throw std::invalid_argument("Unknown field in: " + req.get_param_value("fields"));
+                }
+                size_t limit = req.has_param("limit") ? std::stoul(req.get_param_value("limit")) : 100;
+                limit = std::min<size_t>(std::max<size_t>(limit, 1), 1000);
+
+                std::shared_ptr<StockStream> stream = dbManager.streamStocks(fields, req.get_param_value("cursor"), limit);
+                if (!stream) {
+                    res.status = 500;
+                    json response_json = {{"success", false}, {"message", "Failed to read stocks."}};
+                    res.set_content(response_json.dump(), "application/json");
+                    return;
+                }
+                res.set_chunked_content_provider("application/json", [stream](size_t, httplib::DataSink& sink) {
+                    const std::string& chunk = stream->next();
+                    if (!stream->ok()) {
+                        return false; // abandons the response; the client sees it cut short
+                    }
+                    if (!chunk.empty() && !sink.write(chunk.data(), chunk.size())) {
+                        return false;
+                    }
+                    if (stream->done()) {
+                        sink.done();
+                    }
+                    return true;
+                });
+            } catch (const std::exception& e) {
+                res.status = 400;
+                json response_json = {{"success", false}, {"message", e.what()}};
+                res.set_content(response_json.dump(), "application/json");
+            }
+            return;
+        }
         try {
-            json stocks_json = dbManager.getAllStocksAsJson();
-            res.set_content(stocks_json.dump(), "application/json");
+            auto snapshot = quoteCache.current();
+            if (!snapshot) {
+                snapshot = refreshQuotes();
+            }
+            Encoding encoding = negotiateEncoding(req.get_header_value("Accept"), true);
+            const std::string& etag = snapshot->etag(encoding);
+            res.set_header("Vary", "Accept");
+            res.set_header("ETag", etag);
+            std::string ifNoneMatch = req.get_header_value("If-None-Match");
+            if (!ifNoneMatch.empty() &&
+                (ifNoneMatch == "*" || ifNoneMatch.find(etag) != std::string::npos)) {
+                res.status = 304; // Not Modified
+                return;
+            }
+            // Sent from the shared snapshot, which the provider keeps alive, rather than copied
+            const std::string& body = snapshot->encoded(encoding);
+            res.set_content_provider(body.size(), contentType(encoding),
+                [snapshot, data = body.data()](size_t offset, size_t length, httplib::DataSink& sink) {
+                    return sink.write(data + offset, length);
+                });
         } catch (const std::exception& e) {
             res.status = 500;
             json response_json = {{"success", false}, {"message", e.what()}};
@@ -167,22 +695,275 @@ int main() {
         }
     });
 
+    // GET /quotes/stream?symbols=AAPL,MSFT
+    // Server-Sent Events: the current quote of each symbol (all of them
+    // without symbols=), then an event whenever an ingest changes one.
+    svr.Get("/quotes/stream", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger::info("/quotes/stream endpoint hit");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        std::vector<SymbolId> symbols;
+        std::string list = req.get_param_value("symbols");
+        for (size_t start = 0; start < list.size();) {
+            size_t end = std::min(list.find(',', start), list.size());
+            SymbolId id;
+            if (!SymbolTable::global().find(std::string_view(list).substr(start, end - start), id)) {
+                res.status = 400;
+                json response_json = {{"success", false}, {"message", "Unknown symbol: " + list.substr(start, end - start)}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            symbols.push_back(id);
+            start = end + 1;
+        }
+        if (quoteStream.full()) {
+            res.status = 503;
+            json response_json = {{"success", false}, {"message", "Too many stream subscribers."}};
+            res.set_content(response_json.dump(), "application/json");
+            return;
+        }
+
+        res.set_header("Cache-Control", "no-cache");
+        // Under the event loop the connection is handed to the stream once
+        // the headers are out, and no worker stays tied to it.
+        if (EventLoopServer::handOver([&quoteStream, symbols](socket_t sock) { quoteStream.attach(sock, symbols); })) {
+            res.set_header("Transfer-Encoding", "chunked");
+            res.set_content_provider("text/event-stream", [](size_t, httplib::DataSink& sink) {
+                sink.done(); // the stream writes the body
+                return true;
+            });
+            return;
+        }
+        auto subscriber = quoteStream.subscribe(symbols);
+        if (!subscriber) {
+            res.status = 503;
+            json response_json = {{"success", false}, {"message", "Too many stream subscribers."}};
+            res.set_content(response_json.dump(), "application/json");
+            return;
+        }
+        res.set_chunked_content_provider("text/event-stream",
+            [&quoteStream, subscriber, events = std::string()](size_t, httplib::DataSink& sink) mutable {
+                if (!quoteStream.next(*subscriber, events, QuoteStream::HEARTBEAT)) {
+                    return false;
+                }
+                if (events.empty()) {
+                    events = ":\n\n"; // heartbeat; also finds clients that have gone
+                }
+                return sink.write(events.data(), events.size());
+            },
+            [&quoteStream, subscriber](bool) { quoteStream.unsubscribe(subscriber); });
+    });
+
     // POST /update_stocks
-    svr.Post("/update_stocks", [&](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "[INFO] /update_stocks endpoint hit" << std::endl;
+    // Always ingests QUOTES_CSV_FILE; clients cannot name another file.
+    svr.Post("/update_stocks", [&](const httplib::Request&, httplib::Response& res) {
+        Logger::info("/update_stocks endpoint hit");
         res.set_header("Access-Control-Allow-Origin", "*");
-        int returnCode = system("python stockdb.py");
-        if (returnCode == 0) {
-            res.set_content(R"({"success": true, "message": "Stock database updated."})", "application/json");
-        } else {
-            res.status = 500;
-            res.set_content(R"({"success": false, "message": "Failed to execute Python script."})", "application/json");
+        try {
+            int64_t jobId = dbManager.updateStockDatabase(QUOTES_CSV_FILE);
+            if (jobId == 0) {
+                res.status = 503; // Service Unavailable
+                json response_json = {{"success", false}, {"message", "Too many stock updates queued."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            res.status = 202; // Accepted
+            json response_json = {
+                {"success", true},
+                {"jobId", jobId},
+                {"message", "Stock database update queued."}
+            };
+            res.set_content(response_json.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json response_json = {{"success", false}, {"message", e.what()}};
+            res.set_content(response_json.dump(), "application/json");
+        }
+    });
+
+    // GET /update_stocks/<jobId>
+    svr.Get(R"(/update_stocks/(\d+))", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger::info("/update_stocks status endpoint hit");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        IngestJob job;
+        if (!dbManager.getIngestJob(std::stoll(req.matches[1]), job)) {
+            res.status = 404;
+            json response_json = {{"success", false}, {"message", "Unknown job id."}};
+            res.set_content(response_json.dump(), "application/json");
+            return;
+        }
+        json response_json = {
+            {"success", job.status != "failed"},
+            {"jobId", job.id},
+            {"status", job.status},
+            {"rows", job.rows},
+            {"skipped", job.skipped}
+        };
+        if (!job.error.empty()) {
+            response_json["message"] = job.error;
+        }
+        res.set_content(response_json.dump(), "application/json");
+    });
+
+    // GET /leaderboard?limit=N&offset=M
+    svr.Get("/leaderboard", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger::info("/leaderboard endpoint hit");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        try {
+            size_t limit = req.has_param("limit") ? std::stoul(req.get_param_value("limit")) : 100;
+            size_t offset = req.has_param("offset") ? std::stoul(req.get_param_value("offset")) : 0;
+            limit = std::min<size_t>(limit, 1000);
+
+            auto valuation = valuationEngine.current();
+            if (!valuation) {
+                res.status = 503;
+                json response_json = {{"success", false}, {"message", "Valuation not available yet."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+
+            const PositionColumns& accounts = *valuation->accounts;
+            json ranking = json::array();
+            for (size_t rank = offset; rank < valuation->ranked.size() && rank < offset + limit; ++rank) {
+                const AccountValue& value = valuation->ranked[rank];
+                ranking.push_back({
+                    {"rank", rank + 1},
+                    {"userId", accounts.user_ids[value.account]},
+                    {"username", accounts.usernames[value.account]},
+                    {"equity", value.equity().toDouble()},
+                    {"cash", value.cash.toDouble()},
+                    {"marketValue", value.market_value.toDouble()},
+                    {"unrealizedPnl", value.unrealizedPnl().toDouble()}
+                });
+            }
+            json response_json = {
+                {"success", true},
+                {"version", valuation->version},
+                {"computedAt", std::chrono::duration_cast<std::chrono::seconds>(
+                    valuation->computed_at.time_since_epoch()).count()},
+                {"accounts", valuation->ranked.size()},
+                {"leaderboard", ranking}
+            };
+            res.set_content(response_json.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json response_json = {{"success", false}, {"message", e.what()}};
+            res.set_content(response_json.dump(), "application/json");
+        }
+    });
+
+    // GET /log_level and POST /log_level {"level": "warn"}; changing the level needs the admin token
+    svr.Get("/log_level", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        json response_json = {
+            {"success", true},
+            {"level", logLevelName(Logger::global().level())},
+            {"dropped", Logger::global().droppedCount()}
+        };
+        res.set_content(response_json.dump(), "application/json");
+    });
+
+    svr.Post("/log_level", [&](const httplib::Request& req, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        if (!authorizeAdmin(config.admin_token, req, res)) return;
+        try {
+            auto json_body = json::parse(req.body);
+            LogLevel level;
+            if (!parseLogLevel(json_body.at("level").get<std::string>(), level)) {
+                res.status = 400;
+                json response_json = {{"success", false}, {"message", "Unknown log level."}};
+                res.set_content(response_json.dump(), "application/json");
+                return;
+            }
+            Logger::global().setLevel(level);
+            Logger::warn("Log level set to {}", logLevelName(level));
+            json response_json = {{"success", true}};
+            res.set_content(response_json.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json response_json = {{"success", false}, {"message", e.what()}};
+            res.set_content(response_json.dump(), "application/json");
         }
     });
 
-    std::cout << "[INFO] Server started at http://localhost:8080" << std::endl;
-    svr.listen("localhost", 8080);
+    // GET /metrics, in the Prometheus text format
+    svr.Get("/metrics", [&](const httplib::Request&, httplib::Response& res) {
+        std::string body;
+        Metrics::global().render(body);
+        StatementCacheStats cache = dbManager.getStatementCacheStats();
+        Metrics::writeCounter(body, "statement_cache_hits_total", "Prepared statements reused from the cache.", cache.hits);
+        Metrics::writeCounter(body, "statement_cache_misses_total", "Prepared statements compiled.", cache.misses);
+        GroupCommitStats commits = dbManager.getGroupCommitStats();
+        Metrics::writeCounter(body, "group_commit_batches_total", "Write transactions committed.", commits.batches);
+        Metrics::writeCounter(body, "group_commit_requests_total", "Writes committed in those transactions.", commits.requests);
+        Metrics::writeCounter(body, "log_records_dropped_total", "Log records lost to full buffers.",
+                              Logger::global().droppedCount());
+        QuoteStreamStats stream = quoteStream.stats();
+        Metrics::writeGauge(body, "quote_stream_subscribers", "Open /quotes/stream connections.",
+                            static_cast<double>(stream.subscribers));
+        Metrics::writeCounter(body, "quote_stream_events_total", "Quote events queued to stream subscribers.", stream.events);
+        Metrics::writeCounter(body, "quote_stream_dropped_total", "Stream subscribers disconnected for falling behind.",
+                              stream.dropped);
+        Metrics::writeGauge(body, "sessions_revoked", "Revoked session tokens not yet expired.",
+                            static_cast<double>(sessions.revokedCount()));
+        auto valuation = valuationEngine.current();
+        Metrics::writeGauge(body, "valuation_version", "Version of the latest leaderboard valuation.",
+                            valuation ? static_cast<double>(valuation->version) : 0.0);
+        res.set_content(body, "text/plain; version=0.0.4");
+    });
+
+    // Per-route latency, from routing until the response is about to be
+    // written. The table is filled here and only read once serving starts.
+    struct RouteMetrics {
+        LatencyHistogram* latency;
+        std::atomic<uint64_t>* errors;
+    };
+    std::unordered_map<std::string, RouteMetrics> routeMetrics;
+    auto addRoute = [&routeMetrics](const std::string& method, const std::string& pattern) {
+        std::string route = pattern;
+        size_t id = route.find(R"((\d+))");
+        if (id != std::string::npos) route.replace(id, 5, ":id");
+        std::string labels = "method=\"" + method + "\",route=\"" + route + "\"";
+        routeMetrics[method + " " + pattern] = {
+            &Metrics::global().histogram("http_request_duration_seconds", "Time to handle a request.", labels),
+            &Metrics::global().counter("http_request_errors_total", "Requests answered with a 4xx or 5xx status.", labels)
+        };
+    };
+    for (const char* route : {"/login", "/signin", "/logout", "/transaction", "/order", "/order/cancel", "/update_stocks", "/log_level"}) {
+        addRoute("POST", route);
+    }
+    for (const char* route : {R"(/portfolio/(\d+))", "/stocks", R"(/update_stocks/(\d+))", "/leaderboard", "/log_level", "/metrics", "/quotes/stream"}) {
+        addRoute("GET", route);
+    }
+    addRoute("", "unmatched");
+
+    static thread_local std::chrono::steady_clock::time_point requestStart;
+    svr.set_pre_routing_handler([](const httplib::Request&, httplib::Response&) {
+        requestStart = std::chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_post_routing_handler([&routeMetrics](const httplib::Request& req, httplib::Response& res) {
+        if (requestStart == std::chrono::steady_clock::time_point()) return; // rejected before routing
+        auto found = routeMetrics.find(req.method + " " + req.matched_route);
+        const RouteMetrics& route = found != routeMetrics.end() ? found->second : routeMetrics.at(" unmatched");
+        route.latency->record(std::chrono::steady_clock::now() - requestStart);
+        if (res.status >= 400) route.errors->fetch_add(1, std::memory_order_relaxed);
+        requestStart = std::chrono::steady_clock::time_point();
+    });
+
+    Logger::info("Server started at http://{}:{} with {} workers", config.host, config.port, config.threads);
+    if (!svr.listen(config.host, config.port)) {
+        Logger::error("Could not listen on {}:{}", config.host, config.port);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotMtx);
+        stopping = true;
+    }
+    snapshotCv.notify_one();
+    snapshotter.join();
 
+    // The handler captures locals that are destroyed before dbManager
+    dbManager.setIngestCompletionHandler(nullptr);
     return 0;
 }
 
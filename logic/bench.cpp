@@ -0,0 +1,363 @@
+// Microbenchmarks for the server's hot paths.
+//
+// Build (from logic/):
+//   g++ -std=c++17 -O2 -I. -o bench bench.cpp $(ls *.cpp | grep -v -e api_server -e EventLoopServer -e load_gen -e bench -e recovery_check) -lsqlite3 -lcrypto -pthread
+//
+// Run:
+//   ./bench [--filter SUBSTRING] [--quick] [--dir SCRATCH_DIR]
+//
+// Each result is printed as one JSON object per line, e.g.
+//   {"name":"portfolio_buy","param":1000,"iterations":4194304,"ns_per_op":21.4,...}
+// where param is the size the case was run at (holdings, transactions or
+// symbols). ns_per_op is the median of several timed samples. Compare runs
+// with any JSON-lines tool. Databases are generated under --dir (the system
+// temp directory by default) and removed afterwards.
+
+#include "DatabaseManager.h"
+#include "Portfolio.h"
+#include "SymbolTable.h"
+#include "Logger.h"
+#include "JsonWriter.h"
+#include "sqlite3.h"
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string filter;
+    bool quick = false;
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+};
+
+Options options;
+
+// Times @p op, which performs @p ops_per_call operations per call. The batch
+// size doubles until a batch takes at least 20 ms, then five batches are
+// timed and the median is reported.
+template <typename Op>
+void run(const std::string& name, long long param, Op op, uint64_t ops_per_call = 1) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+
+    auto time = [&op](uint64_t calls) {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < calls; ++i) op();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    uint64_t calls = 1;
+    const double target_ns = options.quick ? 2e6 : 2e7;
+    while (time(calls) < target_ns && calls < (uint64_t(1) << 40)) calls *= 2;
+
+    std::vector<double> samples;
+    for (int i = 0; i < 5; ++i) samples.push_back(time(calls) / (calls * ops_per_call));
+    std::sort(samples.begin(), samples.end());
+
+    nlohmann::ordered_json result = {
+        {"name", name},
+        {"param", param},
+        {"iterations", calls * ops_per_call * samples.size()},
+        {"ns_per_op", samples[samples.size() / 2]},
+        {"min_ns_per_op", samples.front()},
+        {"max_ns_per_op", samples.back()}
+    };
+    std::printf("%s\n", result.dump().c_str());
+    std::fflush(stdout);
+}
+
+bool selected(const char* prefix) {
+    if (options.filter.empty()) return true;
+    std::string name(prefix);
+    return name.find(options.filter) != std::string::npos || options.filter.find(name) != std::string::npos;
+}
+
+// Synthetic symbol for index @p i: S00000, S00001, ...
+std::string symbolName(size_t i) {
+    char symbol[24]; // room for any size_t
+    std::snprintf(symbol, sizeof(symbol), "S%05zu", i);
+    return symbol;
+}
+
+std::vector<SymbolId> makeSymbols(size_t count) {
+    std::vector<SymbolId> ids;
+    for (size_t i = 0; i < count; ++i) {
+        ids.push_back(SymbolTable::global().intern(symbolName(i)));
+    }
+    return ids;
+}
+
+// Synthetic data generators write straight to SQLite, in one transaction, so
+// a million rows take seconds rather than a million group commits.
+class Generator {
+public:
+    explicit Generator(const std::string& path) {
+        sqlite3_open(path.c_str(), &db);
+        sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    }
+    ~Generator() {
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        sqlite3_close(db);
+    }
+
+    // Stocks S00000.. with a quote each, up to @p count in total.
+    void stocks(size_t from, size_t count) {
+        sqlite3_stmt* stock = prepare(
+            "INSERT INTO Stock (Symbol, CompanyName, DayHigh, DayLow, PreviousClose, PERatio, DividendYield, "
+            "FiftyTwoWeekLow, FiftyTwoWeekHigh) VALUES (?, ?, 101.5, 98.25, 99.75, 24.5, 0.8, 61.0, 140.0);");
+        sqlite3_stmt* quote = prepare("INSERT INTO MarketData (StockID, Price, Volume) VALUES (?, ?, ?);");
+        for (size_t i = from; i < count; ++i) {
+            std::string symbol = symbolName(i);
+            std::string company = "Synthetic Company " + std::to_string(i) + " Inc.";
+            sqlite3_bind_text(stock, 1, symbol.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stock, 2, company.c_str(), -1, SQLITE_TRANSIENT);
+            step(stock);
+            sqlite3_bind_int64(quote, 1, sqlite3_last_insert_rowid(db));
+            sqlite3_bind_double(quote, 2, 50.0 + (i % 1000) * 0.37);
+            sqlite3_bind_int64(quote, 3, 1000000 + static_cast<sqlite3_int64>(i));
+            step(quote);
+        }
+        sqlite3_finalize(stock);
+        sqlite3_finalize(quote);
+    }
+
+    // A user with @p transactions trades spread over @p positions stocks,
+    // and the positions they net out to.
+    int user(const std::string& name, size_t transactions, size_t positions) {
+        sqlite3_stmt* user = prepare("INSERT INTO User (Username, Email, PasswordHash) VALUES (?, ?, 'x');");
+        sqlite3_bind_text(user, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(user, 2, (name + "@example.com").c_str(), -1, SQLITE_TRANSIENT);
+        step(user);
+        sqlite3_finalize(user);
+        int user_id = static_cast<int>(sqlite3_last_insert_rowid(db));
+
+        sqlite3_stmt* cash = prepare("INSERT INTO Portfolio (UserID, CashMicros) VALUES (?, 1000000000000);");
+        sqlite3_bind_int(cash, 1, user_id);
+        step(cash);
+        sqlite3_finalize(cash);
+
+        sqlite3_stmt* trade = prepare(
+            "INSERT INTO UserTransaction (UserID, StockID, TransactionType, Quantity, Price) VALUES (?, ?, 'buy', 1, 100.0);");
+        for (size_t i = 0; i < transactions; ++i) {
+            sqlite3_bind_int(trade, 1, user_id);
+            sqlite3_bind_int64(trade, 2, 1 + static_cast<sqlite3_int64>(i % positions));
+            step(trade);
+        }
+        sqlite3_finalize(trade);
+
+        sqlite3_stmt* position = prepare(
+            "INSERT INTO Position (UserID, StockID, Quantity, CostBasisMicros) VALUES (?, ?, ?, ?);");
+        for (size_t p = 0; p < positions; ++p) {
+            sqlite3_int64 quantity = static_cast<sqlite3_int64>(transactions / positions + (p < transactions % positions));
+            sqlite3_bind_int(position, 1, user_id);
+            sqlite3_bind_int64(position, 2, 1 + static_cast<sqlite3_int64>(p));
+            sqlite3_bind_int64(position, 3, quantity);
+            sqlite3_bind_int64(position, 4, quantity * 100000000);
+            step(position);
+        }
+        sqlite3_finalize(position);
+        return user_id;
+    }
+
+private:
+    sqlite3_stmt* prepare(const char* sql) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            std::fprintf(stderr, "prepare failed: %s\n", sqlite3_errmsg(db));
+            std::exit(1);
+        }
+        return stmt;
+    }
+    void step(sqlite3_stmt* stmt) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::fprintf(stderr, "insert failed: %s\n", sqlite3_errmsg(db));
+            std::exit(1);
+        }
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+
+    sqlite3* db = nullptr;
+};
+
+// A fresh, initialized database under the scratch directory.
+struct ScratchDatabase {
+    std::string path;
+    explicit ScratchDatabase(const std::string& name) : path((options.dir / name).string()) {
+        remove();
+        DatabaseManager(path).initializeDatabase();
+    }
+    ~ScratchDatabase() { remove(); }
+    void remove() {
+        for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path + suffix);
+    }
+};
+
+Portfolio portfolioWith(const std::vector<SymbolId>& symbols, size_t holdings) {
+    Portfolio portfolio;
+    portfolio.setFundBalance(Money::fromUnits(1000000000000LL));
+    portfolio.reserve(holdings);
+    for (size_t i = 0; i < holdings; ++i) {
+        portfolio.addStock(Stock(symbols[i], 1000000000, Money::fromMicros(100000000 + 10000 * i)));
+    }
+    return portfolio;
+}
+
+void benchPortfolio() {
+    if (!selected("portfolio_")) return;
+    std::vector<SymbolId> symbols = makeSymbols(10000);
+    std::mt19937 random(42);
+    for (size_t holdings : {10, 100, 1000, 10000}) {
+        Portfolio portfolio = portfolioWith(symbols, holdings);
+        std::vector<SymbolId> order(4096);
+        for (SymbolId& id : order) id = symbols[random() % holdings];
+        size_t next = 0;
+        // Pending trades are cleared now and then, as savePortfolio's caller
+        // would, so the vector does not grow for the whole run.
+        run("portfolio_buy", holdings, [&] {
+            portfolio.buyStock(order[next++ & 4095], 1, Money::fromUnits(100));
+            if ((next & 1023) == 0) portfolio.clearPendingTrades();
+        });
+        run("portfolio_sell", holdings, [&] {
+            portfolio.sellStock(order[next++ & 4095], 1, Money::fromUnits(100));
+            if ((next & 1023) == 0) portfolio.clearPendingTrades();
+        });
+    }
+}
+
+// The /portfolio body, built as a DOM then dumped (as the handler used to)
+// and streamed with JsonWriter.
+void benchPortfolioJson() {
+    if (!selected("portfolio_json")) return;
+    std::vector<SymbolId> symbols = makeSymbols(10000);
+    for (size_t holdings : {10, 100, 1000, 10000}) {
+        Portfolio portfolio = portfolioWith(symbols, holdings);
+        std::string body;
+        run("portfolio_json_dom", holdings, [&] {
+            json portfolio_json;
+            portfolio_json["fundBalance"] = portfolio.getFundBalance().toDouble();
+            json stocks_json = json::array();
+            for (const auto& stock : portfolio.getStocks()) {
+                stocks_json.push_back({
+                    {"symbol", stock.getSymbol()},
+                    {"quantity", stock.getQuantity()},
+                    {"purchase_price", stock.getPurchasePrice().toDouble()}
+                });
+            }
+            portfolio_json["stocks"] = stocks_json;
+            body = portfolio_json.dump();
+        });
+        // The handler as it is now: streamed into a reused buffer.
+        run("portfolio_json_writer", holdings, [&] {
+            body.clear();
+            JsonWriter writer(body);
+            writer.beginObject();
+            writer.key("\"fundBalance\":");
+            writer.value(portfolio.getFundBalance());
+            writer.key("\"stocks\":");
+            writer.beginArray();
+            for (const auto& stock : portfolio.getStocks()) {
+                writer.beginObject();
+                writer.key("\"purchase_price\":");
+                writer.value(stock.getPurchasePrice());
+                writer.key("\"quantity\":");
+                writer.value(stock.getQuantity());
+                writer.key("\"symbol\":");
+                writer.value(stock.getSymbol());
+                writer.endObject();
+            }
+            writer.endArray();
+            writer.endObject();
+        });
+    }
+}
+
+void benchLoadPortfolio() {
+    if (!selected("load_portfolio")) return;
+    ScratchDatabase scratch("bench_history.db");
+    std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    if (options.quick) sizes.pop_back();
+    std::vector<int> users;
+    {
+        Generator generate(scratch.path);
+        generate.stocks(0, 50);
+        for (size_t transactions : sizes) {
+            users.push_back(generate.user("history_" + std::to_string(transactions), transactions, 50));
+        }
+    }
+    DatabaseManager db(scratch.path);
+    db.initializeDatabase();
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        run("load_portfolio", static_cast<long long>(sizes[i]), [&] {
+            Portfolio portfolio;
+            db.loadPortfolio(users[i], portfolio);
+        });
+    }
+}
+
+void benchAllStocks() {
+    if (!selected("all_stocks_json")) return;
+    ScratchDatabase scratch("bench_stocks.db");
+    DatabaseManager db(scratch.path);
+    db.initializeDatabase();
+    size_t loaded = 0;
+    for (size_t count : {10, 100, 1000, 10000, 50000}) {
+        {
+            Generator generate(scratch.path);
+            generate.stocks(loaded, count);
+        }
+        loaded = count;
+        std::string body;
+        run("all_stocks_json", static_cast<long long>(count), [&] {
+            body.clear();
+            db.writeAllStocksJson(body);
+        });
+    }
+
+    // One page out of the 50000, every field and then only Symbol,Price.
+    uint32_t symbol_price = 0;
+    StockStream::parseFields("Symbol,Price", symbol_price);
+    for (uint32_t fields : {StockStream::ALL_FIELDS, symbol_price}) {
+        const char* name = fields == StockStream::ALL_FIELDS ? "stocks_page" : "stocks_page_projected";
+        for (size_t limit : {100, 1000}) {
+            run(name, static_cast<long long>(limit), [&] {
+                auto stream = db.streamStocks(fields, "", limit);
+                while (!stream->done()) stream->next();
+            });
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--dir" && i + 1 < argc) {
+            options.dir = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter SUBSTRING] [--quick] [--dir SCRATCH_DIR]\n", argv[0]);
+            return 2;
+        }
+    }
+    // Keep the server's informational logging out of the results.
+    Logger::global().setLevel(LogLevel::Warn);
+
+    benchPortfolio();
+    benchPortfolioJson();
+    benchLoadPortfolio();
+    benchAllStocks();
+    return 0;
+}
@@ -0,0 +1,306 @@
+// Open-loop HTTP load generator for api_server.
+//
+// Build (from logic/):
+//   g++ -std=c++17 -O2 -I. load_gen.cpp Metrics.cpp -pthread -o load_gen
+//
+// Run against a server started on a scratch copy of the database:
+//   ./load_gen --rate 2000 --duration 30 --warmup 5 --connections 64
+//              --mix login=1,portfolio=6,transaction=2,stocks=1
+// (one line). Every option has a default; run with no arguments to see them.
+//
+// Requests are issued on a fixed schedule, one every 1/rate seconds,
+// whether or not earlier ones have finished. Latency is measured from when
+// a request was due rather than when a connection got round to sending it,
+// so a stalled server shows up as queueing delay instead of being hidden by
+// a load generator that politely waited (coordinated omission). Service
+// time, from send to response, is reported alongside for comparison.
+
+#include "httplib.h"
+#include "json.hpp"
+#include "Metrics.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum Operation { Login, Portfolio, Transaction, Stocks, OPERATION_COUNT };
+const char* OPERATION_NAMES[] = {"login", "portfolio", "transaction", "stocks"};
+
+struct Options {
+    std::string host = "localhost";
+    int port = 8080;
+    double rate = 1000;       // requests per second, across all connections
+    double duration = 30;     // seconds measured, after the warmup
+    double warmup = 5;        // seconds run but not measured
+    size_t connections = 64;  // one thread and keep-alive connection each
+    size_t users = 100;       // accounts created for the run
+    unsigned weights[OPERATION_COUNT] = {1, 6, 2, 1};
+};
+
+struct LoadUser {
+    std::string username;
+    int user_id;
+    httplib::Headers auth; // bearer token from signing up or logging in
+};
+
+struct Stats {
+    LatencyHistogram latency; // from the scheduled start
+    LatencyHistogram service; // from the actual send
+    std::atomic<uint64_t> errors{0};
+};
+
+// A user's trades are sent one at a time and alternate buy and sell, so a
+// sell never overtakes the buy it undoes.
+struct Trading {
+    std::mutex mtx;
+    uint64_t applied = 0; // trades the server accepted
+};
+
+const std::string PASSWORD = "load-gen-password";
+
+bool parseMix(const std::string& mix, unsigned* weights) {
+    for (size_t i = 0; i < OPERATION_COUNT; ++i) weights[i] = 0;
+    size_t start = 0;
+    while (start < mix.size()) {
+        size_t end = mix.find(',', start);
+        if (end == std::string::npos) end = mix.size();
+        std::string item = mix.substr(start, end - start);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string name = item.substr(0, eq);
+        size_t op = 0;
+        while (op < OPERATION_COUNT && name != OPERATION_NAMES[op]) ++op;
+        if (op == OPERATION_COUNT) return false;
+        weights[op] = static_cast<unsigned>(std::stoul(item.substr(eq + 1)));
+        start = end + 1;
+    }
+    unsigned total = 0;
+    for (size_t i = 0; i < OPERATION_COUNT; ++i) total += weights[i];
+    return total > 0;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--host") options.host = value;
+        else if (key == "--port") options.port = std::stoi(value);
+        else if (key == "--rate") options.rate = std::stod(value);
+        else if (key == "--duration") options.duration = std::stod(value);
+        else if (key == "--warmup") options.warmup = std::stod(value);
+        else if (key == "--connections") options.connections = std::stoul(value);
+        else if (key == "--users") options.users = std::stoul(value);
+        else if (key == "--mix") {
+            if (!parseMix(value, options.weights)) return false;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options.rate > 0 && options.connections > 0 && options.users > 0;
+}
+
+// Spreads the mix evenly over the schedule: request k always gets the same
+// operation, so runs with the same options issue the same sequence.
+Operation operationFor(uint64_t k, const unsigned* weights) {
+    unsigned total = 0;
+    for (size_t i = 0; i < OPERATION_COUNT; ++i) total += weights[i];
+    unsigned slot = static_cast<unsigned>((k * 2654435761u) % total);
+    for (size_t i = 0; i < OPERATION_COUNT; ++i) {
+        if (slot < weights[i]) return static_cast<Operation>(i);
+        slot -= weights[i];
+    }
+    return Portfolio;
+}
+
+// Signs up the run's users, or logs in as them if a previous run made them.
+bool createUsers(httplib::Client& client, size_t count, std::vector<LoadUser>& users) {
+    for (size_t i = 0; i < count; ++i) {
+        std::string username = "loadgen_" + std::to_string(i);
+        json body = {{"username", username}, {"password", PASSWORD}, {"email", username + "@example.com"}};
+        auto res = client.Post("/signin", body.dump(), "application/json");
+        if (!res || res->status != 200) {
+            res = client.Post("/login", body.dump(), "application/json");
+        }
+        if (!res || res->status != 200) {
+            std::cerr << "[ERROR] Could not create or log in as " << username << std::endl;
+            return false;
+        }
+        json account = json::parse(res->body);
+        users.push_back({username, account.at("userId").get<int>(),
+                         {{"Authorization", "Bearer " + account.at("token").get<std::string>()}}});
+    }
+    return true;
+}
+
+bool loadSymbols(httplib::Client& client, std::vector<std::pair<std::string, double>>& symbols) {
+    auto res = client.Get("/stocks");
+    if (!res || res->status != 200) return false;
+    for (const auto& stock : json::parse(res->body)) {
+        if (stock.contains("Symbol") && stock.contains("Price") && stock["Price"].is_number()) {
+            symbols.emplace_back(stock["Symbol"].get<std::string>(), stock["Price"].get<double>());
+        }
+    }
+    return !symbols.empty();
+}
+
+uint64_t percentile(const std::vector<uint64_t>& counts, uint64_t total, double quantile) {
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) return LatencyHistogram::bucketUpperBound(bucket);
+    }
+    return 0;
+}
+
+void printRow(const char* name, const char* kind, const LatencyHistogram& histogram) {
+    std::vector<uint64_t> counts;
+    uint64_t sum_nanos;
+    histogram.snapshot(counts, sum_nanos);
+    uint64_t total = 0;
+    for (uint64_t count : counts) total += count;
+    if (total == 0) return;
+    std::printf("%-12s %-8s %9llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, kind,
+                static_cast<unsigned long long>(total), sum_nanos / 1e6 / total,
+                percentile(counts, total, 0.5) / 1e6, percentile(counts, total, 0.9) / 1e6,
+                percentile(counts, total, 0.99) / 1e6, percentile(counts, total, 0.999) / 1e6,
+                percentile(counts, total, 1.0) / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--host H] [--port P] [--rate REQ_PER_SEC] [--duration SEC]"
+                  << " [--warmup SEC] [--connections N] [--users N]"
+                  << " [--mix login=1,portfolio=6,transaction=2,stocks=1]" << std::endl;
+        return 2;
+    }
+
+    httplib::Client setup(options.host, options.port);
+    std::vector<LoadUser> users;
+    std::vector<std::pair<std::string, double>> symbols;
+    if (!createUsers(setup, options.users, users) || !loadSymbols(setup, symbols)) {
+        std::cerr << "[FATAL] Could not set up the run against " << options.host << ":" << options.port << std::endl;
+        return 1;
+    }
+
+    const auto interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / options.rate));
+    const auto start = Clock::now() + std::chrono::milliseconds(100);
+    const auto measure_from = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.warmup));
+    const auto stop = measure_from + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.duration));
+
+    std::vector<Stats> stats(OPERATION_COUNT);
+    std::vector<Trading> trading(users.size());
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> late{0}; // no connection free until 1 ms after they were due
+
+    auto worker = [&]() {
+        httplib::Client client(options.host, options.port);
+        client.set_keep_alive(true);
+        client.set_tcp_nodelay(true);
+        client.set_connection_timeout(5);
+        client.set_read_timeout(30);
+        for (;;) {
+            uint64_t k = next.fetch_add(1, std::memory_order_relaxed);
+            Clock::time_point due = start + interval * k;
+            if (due >= stop) break;
+            Clock::time_point picked = Clock::now();
+            std::this_thread::sleep_until(due);
+
+            Operation op = operationFor(k, options.weights);
+            const LoadUser& user = users[k % users.size()];
+            std::unique_lock<std::mutex> trade_lock;
+            if (op == Transaction) trade_lock = std::unique_lock<std::mutex>(trading[k % users.size()].mtx);
+            Clock::time_point sent = Clock::now();
+            httplib::Result res;
+            switch (op) {
+            case Login: {
+                json body = {{"username", user.username}, {"password", PASSWORD}};
+                res = client.Post("/login", body.dump(), "application/json");
+                break;
+            }
+            case Portfolio:
+                res = client.Get("/portfolio/" + std::to_string(user.user_id), user.auth);
+                break;
+            case Transaction: {
+                // Buy one share, then sell it back at the same price, so each
+                // user's cash and holdings return to where they started after
+                // every pair of accepted trades.
+                uint64_t applied = trading[k % users.size()].applied;
+                const auto& symbol = symbols[applied / 2 % symbols.size()];
+                json body = {
+                    {"userId", user.user_id},
+                    {"type", applied % 2 == 0 ? "buy" : "sell"},
+                    {"symbol", symbol.first},
+                    {"quantity", 1},
+                    {"price", symbol.second}
+                };
+                res = client.Post("/transaction", user.auth, body.dump(), "application/json");
+                break;
+            }
+            default:
+                res = client.Get("/stocks");
+                break;
+            }
+            Clock::time_point done = Clock::now();
+            // A rejected request can still come back as 200 with success:false.
+            bool ok = res && res->status == 200 && res->body.find("\"success\":false") == std::string::npos;
+            if (trade_lock.owns_lock()) {
+                if (ok) ++trading[k % users.size()].applied;
+                trade_lock.unlock();
+            }
+
+            if (due < measure_from) continue;
+            stats[op].latency.record(done - due);
+            stats[op].service.record(done - sent);
+            if (!ok) stats[op].errors.fetch_add(1, std::memory_order_relaxed);
+            if (picked - due > std::chrono::milliseconds(1)) late.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < options.connections; ++i) threads.emplace_back(worker);
+    for (auto& thread : threads) thread.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - measure_from).count();
+
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    for (const Stats& s : stats) {
+        std::vector<uint64_t> counts;
+        uint64_t sum_nanos;
+        s.latency.snapshot(counts, sum_nanos);
+        for (uint64_t count : counts) completed += count;
+        errors += s.errors.load();
+    }
+
+    std::printf("target %.0f req/s over %.0f s, %zu connections: %llu requests, %.0f req/s achieved, "
+                "%llu errors, %llu waited for a connection\n\n",
+                options.rate, options.duration, options.connections, static_cast<unsigned long long>(completed),
+                completed / elapsed, static_cast<unsigned long long>(errors),
+                static_cast<unsigned long long>(late.load()));
+    if (late.load() > completed / 100) {
+        std::printf("more than 1%% of requests waited for a free connection; raise --connections\n\n");
+    }
+    std::printf("%-12s %-8s %9s %9s %9s %9s %9s %9s %9s\n", "operation", "measure", "count", "mean ms", "p50 ms",
+                "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+        printRow(OPERATION_NAMES[op], "latency", stats[op].latency);
+        printRow(OPERATION_NAMES[op], "service", stats[op].service);
+    }
+    return errors == 0 ? 0 : 1;
+}
@@ -1,67 +1,215 @@
 #include "Portfolio.h"
-#include <iostream>
-#include <algorithm>
+#include "Logger.h"
+
+namespace {
+
+// Fibonacci hashing spreads the dense, sequential SymbolIds across the table.
+inline size_t slotFor(SymbolId symbol_id, unsigned bits) {
+    return static_cast<uint32_t>(symbol_id * 2654435769u) >> (32 - bits);
+}
+
+constexpr size_t MIN_SLOTS = 16;
+
+} // namespace
 
 // Default constructor implementation
-Portfolio::Portfolio() : fundBalance(10000.0) {} // Default starting balance
+Portfolio::Portfolio() : fundBalance(DEFAULT_FUND_BALANCE) {} // Default starting balance
 
 // New constructor implementation
-Portfolio::Portfolio(double initial_balance) : fundBalance(initial_balance) {}
+Portfolio::Portfolio(Money initial_balance) : fundBalance(initial_balance) {}
 
-double Portfolio::getFundBalance() const {
+Money Portfolio::getFundBalance() const {
     return fundBalance;
 }
 
-const std::vector<std::shared_ptr<Stock>>& Portfolio::getStocks() const {
-    return stocks;
+Portfolio::Holdings Portfolio::getStocks() const {
+    const Stock* first = positions.data();
+    return Holdings(first, first + positions.size(), live);
+}
+
+int Portfolio::getHeldQuantity(SymbolId symbol) const {
+    const Stock* stock = find(symbol);
+    return stock != nullptr ? stock->getQuantity() : 0;
 }
 
-void Portfolio::setFundBalance(double balance) {
+const std::vector<Trade>& Portfolio::getPendingTrades() const {
+    return pendingTrades;
+}
+
+void Portfolio::clearPendingTrades() {
+    pendingTrades.clear();
+}
+
+void Portfolio::setFundBalance(Money balance) {
     fundBalance = balance;
 }
 
+void Portfolio::reserve(size_t count) {
+    positions.reserve(count);
+    size_t capacity = MIN_SLOTS;
+    while (capacity < count * 2) capacity *= 2;
+    if (capacity > slots.size()) rehash(capacity);
+}
+
 void Portfolio::addStock(const Stock& stock) {
-    stocks.push_back(std::make_shared<Stock>(stock));
+    Stock* existing = find(stock.getSymbolId());
+    if (existing == nullptr) {
+        insert(stock);
+    } else if (existing->getQuantity() == 0) {
+        *existing = stock;
+        if (stock.getQuantity() > 0) ++live;
+    } else {
+        existing->addToQuantity(stock.getQuantity());
+    }
 }
 
-bool Portfolio::buyStock(const std::string& symbol, int quantity, double price) {
-    double totalCost = quantity * price;
+bool Portfolio::buyStock(SymbolId symbol, int quantity, Money price) {
+    if (quantity <= 0 || price <= Money()) {
+        Logger::error("Trade quantity and price must be positive.");
+        return false;
+    }
+    Money totalCost;
+    if (!Money::multiply(price, quantity, totalCost)) {
+        Logger::error("Trade amount out of range.");
+        return false;
+    }
     if (fundBalance < totalCost) {
-        std::cerr << "[ERROR] Insufficient funds." << std::endl;
+        Logger::error("Insufficient funds.");
         return false;
     }
 
-    // Find if stock already exists
-    auto it = std::find_if(stocks.begin(), stocks.end(), 
-        [&](const auto& s) { return s->getSymbol() == symbol; });
-        
-    if (it != stocks.end()) { // Stock exists
-        (*it)->addToQuantity(quantity);
-    } else { // New stock
-        stocks.push_back(std::make_shared<Stock>(symbol, quantity, price));
-    }
-    
+    addStock(Stock(symbol, quantity, price));
+
     fundBalance -= totalCost;
+    pendingTrades.push_back({symbol, "buy", quantity, price});
     return true;
 }
 
-bool Portfolio::sellStock(const std::string& symbol, int quantity, double price) {
-    auto it = std::find_if(stocks.begin(), stocks.end(), 
-        [&](const auto& s) { return s->getSymbol() == symbol; });
+bool Portfolio::sellStock(SymbolId symbol, int quantity, Money price) {
+    if (quantity <= 0 || price <= Money()) {
+        Logger::error("Trade quantity and price must be positive.");
+        return false;
+    }
+    Stock* stock = find(symbol);
 
-    if (it == stocks.end() || (*it)->getQuantity() < quantity) {
-        std::cerr << "[ERROR] Not enough shares to sell." << std::endl;
+    if (stock == nullptr || stock->getQuantity() < quantity) {
+        Logger::error("Not enough shares to sell.");
+        return false;
+    }
+    Money proceeds;
+    if (!Money::multiply(price, quantity, proceeds) || !Money::add(fundBalance, proceeds, proceeds)) {
+        Logger::error("Trade amount out of range.");
         return false;
     }
-    
-    (*it)->removeFromQuantity(quantity);
-    
-    // If quantity is zero, remove the stock from portfolio
-    if ((*it)->getQuantity() == 0) {
-        stocks.erase(it);
+
+    reduce(*stock, quantity);
+
+    fundBalance = proceeds;
+    pendingTrades.push_back({symbol, "sell", quantity, price});
+    return true;
+}
+
+bool Portfolio::covers(const Trade& trade) const {
+    Money amount;
+    if (!Money::multiply(trade.price, trade.quantity, amount)) return false;
+    if (trade.type != "buy") {
+        return getHeldQuantity(trade.symbol) >= trade.quantity && Money::add(fundBalance, amount, amount);
+    }
+    return fundBalance >= amount;
+}
+
+bool Portfolio::applyTrade(const Trade& trade) {
+    Money balance;
+    if (trade.type == "buy") {
+        Money cost;
+        if (!Money::multiply(trade.price, trade.quantity, cost) || !Money::add(fundBalance, -cost, balance)) {
+            Logger::error("Trade amount out of range.");
+            return false;
+        }
+        addStock(Stock(trade.symbol, trade.quantity, trade.price));
+        fundBalance = balance;
+        return true;
     }
 
-    fundBalance += quantity * price;
+    Stock* stock = find(trade.symbol);
+    int held = stock != nullptr ? stock->getQuantity() : 0;
+    if (held < trade.quantity) {
+        Logger::warn("Fill sells {} shares but only {} are held.", trade.quantity, held);
+    }
+    int sold = held < trade.quantity ? held : trade.quantity;
+    Money proceeds;
+    if (!Money::multiply(trade.price, sold, proceeds) || !Money::add(fundBalance, proceeds, balance)) {
+        Logger::error("Trade amount out of range.");
+        return false;
+    }
+    if (sold > 0) {
+        reduce(*stock, sold);
+    }
+    fundBalance = balance;
     return true;
 }
 
+void Portfolio::reduce(Stock& stock, int quantity) {
+    stock.removeFromQuantity(quantity);
+
+    // A sold-out position stays in place until compaction reclaims it
+    if (stock.getQuantity() == 0) {
+        --live;
+        if (positions.size() > MIN_SLOTS && positions.size() > 2 * live) {
+            compact();
+        }
+    }
+}
+
+Stock* Portfolio::find(SymbolId symbol_id) {
+    return const_cast<Stock*>(static_cast<const Portfolio*>(this)->find(symbol_id));
+}
+
+const Stock* Portfolio::find(SymbolId symbol_id) const {
+    if (slots.empty()) return nullptr;
+    size_t mask = slots.size() - 1;
+    for (size_t i = slotFor(symbol_id, slot_bits);; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.offset == EMPTY_SLOT) return nullptr;
+        if (slot.symbol_id == symbol_id) return &positions[slot.offset];
+    }
+}
+
+void Portfolio::insert(const Stock& stock) {
+    if ((positions.size() + 1) * 2 > slots.size()) {
+        rehash(slots.empty() ? MIN_SLOTS : slots.size() * 2);
+    }
+    uint32_t offset = static_cast<uint32_t>(positions.size());
+    positions.push_back(stock);
+    if (stock.getQuantity() > 0) ++live;
+
+    size_t mask = slots.size() - 1;
+    size_t i = slotFor(stock.getSymbolId(), slot_bits);
+    while (slots[i].offset != EMPTY_SLOT) i = (i + 1) & mask;
+    slots[i] = {stock.getSymbolId(), offset};
+}
+
+void Portfolio::rehash(size_t capacity) {
+    slots.assign(capacity, Slot{0, EMPTY_SLOT});
+    slot_bits = 0;
+    while ((size_t(1) << slot_bits) < capacity) ++slot_bits;
+
+    size_t mask = capacity - 1;
+    for (size_t offset = 0; offset < positions.size(); ++offset) {
+        SymbolId symbol_id = positions[offset].getSymbolId();
+        size_t i = slotFor(symbol_id, slot_bits);
+        while (slots[i].offset != EMPTY_SLOT) i = (i + 1) & mask;
+        slots[i] = {symbol_id, static_cast<uint32_t>(offset)};
+    }
+}
+
+void Portfolio::compact() {
+    size_t kept = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (positions[i].getQuantity() == 0) continue;
+        if (kept != i) positions[kept] = std::move(positions[i]);
+        ++kept;
+    }
+    positions.erase(positions.begin() + kept, positions.end());
+    rehash(slots.size());
+}
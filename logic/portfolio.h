@@ -3,30 +3,120 @@
 
 #include <vector>
 #include <string>
-#include <memory>
+#include <cstdint>
 #include "Stock.h"
 
-class Portfolio {
-private:
-    double fundBalance;
-    std::vector<std::shared_ptr<Stock>> stocks;
+// Starting cash for accounts that have never traded.
+constexpr Money DEFAULT_FUND_BALANCE = Money::fromUnits(10000);
+
+// A buy or sell executed on a Portfolio that has not been saved yet.
+struct Trade {
+    SymbolId symbol;
+    std::string type; // "buy" or "sell"
+    int quantity;
+    Money price;
+};
+
+// Outcome of executing a Trade against an account.
+enum class TradeResult {
+    Applied,
+    Rejected, // not enough funds or shares
+    Failed    // could not be read or recorded
+};
 
+/**
+ * @class Portfolio
+ * @brief Cash balance and holdings of one user.
+ *
+ * Holdings are stored contiguously in first-purchase order and indexed by an
+ * open-addressing table keyed on SymbolId, so buys and sells are O(1) however
+ * many symbols are held. A position sold down to zero keeps its record until
+ * enough of them accumulate, then the records are compacted in one pass.
+ */
+class Portfolio {
 public:
+    /**
+     * @class Holdings
+     * @brief Iterable view of the non-empty positions, in first-purchase order.
+     */
+    class Holdings {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(const Stock* pos, const Stock* end) : pos(pos), end(end) { skip(); }
+            const Stock& operator*() const { return *pos; }
+            const Stock* operator->() const { return pos; }
+            const_iterator& operator++() { ++pos; skip(); return *this; }
+            bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+            bool operator==(const const_iterator& other) const { return pos == other.pos; }
+        private:
+            void skip() { while (pos != end && pos->getQuantity() == 0) ++pos; }
+            const Stock* pos;
+            const Stock* end;
+        };
+
+        Holdings(const Stock* first, const Stock* last, size_t count) : first(first), last(last), count(count) {}
+        const_iterator begin() const { return const_iterator(first, last); }
+        const_iterator end() const { return const_iterator(last, last); }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+    private:
+        const Stock* first;
+        const Stock* last;
+        size_t count;
+    };
+
     Portfolio(); // Default constructor
-    Portfolio(double initial_balance); // New constructor for initial funds
-    
+    Portfolio(Money initial_balance); // New constructor for initial funds
+
     // Public interface
-    bool buyStock(const std::string& symbol, int quantity, double price);
-    bool sellStock(const std::string& symbol, int quantity, double price);
-    
+    bool buyStock(SymbolId symbol, int quantity, Money price);
+    bool sellStock(SymbolId symbol, int quantity, Money price);
+
     // Getters
-    double getFundBalance() const;
-    const std::vector<std::shared_ptr<Stock>>& getStocks() const;
+    Money getFundBalance() const;
+    Holdings getStocks() const;
+    int getHeldQuantity(SymbolId symbol) const; // 0 if not held
+    const std::vector<Trade>& getPendingTrades() const;
 
     // Setters / Modifiers (used by DatabaseManager)
-    void setFundBalance(double balance);
+    void setFundBalance(Money balance);
+    void reserve(size_t count);
     void addStock(const Stock& stock);
+    void clearPendingTrades();
+
+    // Whether the account holds the cash (buy) or shares (sell) the trade
+    // needs and its amount and resulting balance are in range.
+    bool covers(const Trade& trade) const;
+
+    // Applies a trade that has already executed elsewhere (a matching-engine
+    // fill) without the funds check. A sell never takes a position below zero
+    // and is credited only for the shares actually held. Not recorded as
+    // pending. Returns false, changing nothing, if the amount or the
+    // resulting balance is out of range.
+    bool applyTrade(const Trade& trade);
+
+private:
+    struct Slot {
+        SymbolId symbol_id;
+        uint32_t offset; // into positions; EMPTY_SLOT if unused
+    };
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    Stock* find(SymbolId symbol_id);
+    const Stock* find(SymbolId symbol_id) const;
+    void insert(const Stock& stock);
+    void rehash(size_t capacity);
+    void reduce(Stock& stock, int quantity);
+    void compact();
+
+    Money fundBalance;
+    std::vector<Stock> positions; // may hold sold-out records (quantity 0)
+    size_t live = 0;              // positions with quantity > 0
+    std::vector<Slot> slots;      // power-of-two size, at most half full
+    unsigned slot_bits = 0;
+    std::vector<Trade> pendingTrades;
 };
 
 #endif // PORTFOLIO_H
-
@@ -0,0 +1,340 @@
+// Crash-recovery checks for the trade journal and the account shards.
+//
+// Build (from logic/):
+//   g++ -std=c++17 -O2 -I. -o recovery_check recovery_check.cpp $(ls *.cpp | grep -v -e api_server -e EventLoopServer -e load_gen -e bench -e recovery_check) -lsqlite3 -lcrypto -pthread
+//
+// Run:
+//   ./recovery_check [--dir SCRATCH_DIR]
+//
+// Each check prints PASS or FAIL followed by its name; the exit status is
+// non-zero if any check failed. Journals and databases are created under
+// --dir (the system temp directory by default) and removed afterwards.
+
+#include "DatabaseManager.h"
+#include "TradeJournal.h"
+#include "Portfolio.h"
+#include "SymbolTable.h"
+#include "Logger.h"
+#include "sqlite3.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Must match the on-disk layout in TradeJournal.cpp.
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t RECORD_SIZE = 64;
+constexpr size_t PRICE_OFFSET = 8;     // DiskRecord::price_micros
+constexpr size_t CRC_OFFSET = 60;      // DiskRecord::crc
+constexpr size_t FIRST_SEQ_OFFSET = 8; // DiskHeader::first_seq
+
+const char* const SYMBOL = "TEST";
+
+std::filesystem::path dir = std::filesystem::temp_directory_path();
+int failures = 0;
+
+void check(const std::string& name, bool ok) {
+    std::printf("%s %s\n", ok ? "PASS" : "FAIL", name.c_str());
+    std::fflush(stdout);
+    if (!ok) ++failures;
+}
+
+JournalRecord buyRecord(int user_id, int quantity, int64_t price_micros) {
+    JournalRecord record;
+    record.user_id = user_id;
+    record.quantity = quantity;
+    record.price_micros = price_micros;
+    record.symbol = SYMBOL;
+    return record;
+}
+
+bool appendRecords(TradeJournal& journal, size_t count, int user_id) {
+    std::vector<JournalRecord> records;
+    for (size_t i = 0; i < count; ++i) {
+        records.push_back(buyRecord(user_id, 1, Money::fromUnits(10).getMicros()));
+    }
+    return journal.append(records) && journal.flush();
+}
+
+// Overwrites @p length bytes at @p offset within record @p index.
+void corrupt(const std::string& path, uint64_t index, size_t offset, size_t length, char value) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(HEADER_SIZE + index * RECORD_SIZE + offset));
+    std::string bytes(length, value);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+size_t readAll(TradeJournal& journal) {
+    std::vector<JournalRecord> records;
+    journal.read(journal.firstSeq(), 1 << 20, records);
+    return records.size();
+}
+
+// A journal file and database under the scratch directory, removed on exit.
+// DatabaseManager::openJournal() uses journal as the name of its per-shard
+// journals rather than as a file.
+struct Scratch {
+    static constexpr size_t MAX_SHARDS = 8;
+
+    std::string name;
+    std::string journal;
+    std::string db;
+    explicit Scratch(const std::string& name)
+        : name(name), journal((dir / (name + ".journal")).string()), db((dir / (name + ".db")).string()) {
+        remove();
+    }
+    ~Scratch() { remove(); }
+    // Journal file of account shard @p index, as named by openJournal().
+    std::string shard(size_t index) const { return (dir / (name + "." + std::to_string(index) + ".journal")).string(); }
+    void remove() {
+        std::filesystem::remove(journal);
+        for (size_t i = 0; i < MAX_SHARDS; ++i) std::filesystem::remove(shard(i));
+        for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(db + suffix);
+    }
+};
+
+int64_t queryInt(const std::string& db_path, const std::string& sql) {
+    sqlite3* db = nullptr;
+    int64_t value = -1;
+    if (sqlite3_open(db_path.c_str(), &db) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return value;
+}
+
+// Creates the schema, the test stock and @p users accounts.
+bool prepareDatabase(const std::string& db_path, int users) {
+    DatabaseManager db(db_path);
+    if (!db.initializeDatabase()) return false;
+    sqlite3* raw = nullptr;
+    bool ok = sqlite3_open(db_path.c_str(), &raw) == SQLITE_OK &&
+              sqlite3_exec(raw, "INSERT INTO Stock (Symbol, CompanyName) VALUES ('TEST', 'Test');", 0, 0, 0) == SQLITE_OK;
+    sqlite3_close(raw);
+    SymbolTable::global().intern(SYMBOL);
+    for (int i = 0; ok && i < users; ++i) {
+        int user_id = 0;
+        std::string name = "user" + std::to_string(i);
+        ok = db.addUser(name, "x", name + "@example.com", user_id);
+    }
+    return ok;
+}
+
+// A record cut short by a crash is dropped together with everything after
+// it, and new appends continue from the intact prefix.
+void checkTornWrite() {
+    Scratch scratch("recovery_torn");
+    {
+        TradeJournal journal;
+        check("torn_write_create", journal.open(scratch.journal, 1) && appendRecords(journal, 10, 1));
+    }
+    corrupt(scratch.journal, 6, CRC_OFFSET - 12, 16, 0);
+
+    {
+        TradeJournal journal;
+        bool opened = journal.open(scratch.journal, 1);
+        check("torn_write_prefix", opened && journal.nextSeq() == 7 && readAll(journal) == 6);
+        check("torn_write_append", appendRecords(journal, 1, 1) && journal.nextSeq() == 8);
+    }
+
+    // Records 8 to 10 were intact on disk; they must not rejoin the journal
+    // now that record 7 has been rewritten.
+    TradeJournal journal;
+    check("torn_write_no_resurrection", journal.open(scratch.journal, 1) && journal.nextSeq() == 8 && readAll(journal) == 7);
+}
+
+// A record whose contents no longer match its checksum ends the journal.
+void checkCrc() {
+    Scratch scratch("recovery_crc");
+    {
+        TradeJournal journal;
+        check("crc_create", journal.open(scratch.journal, 1) && appendRecords(journal, 10, 1));
+    }
+    corrupt(scratch.journal, 3, PRICE_OFFSET, 1, 0x5A);
+
+    TradeJournal journal;
+    check("crc_rejected", journal.open(scratch.journal, 1) && journal.nextSeq() == 4 && readAll(journal) == 3);
+}
+
+// A reset that wrote its new header but crashed before clearing the old
+// records leaves an empty journal starting at the new sequence number.
+void checkInterruptedReset() {
+    Scratch scratch("recovery_reset");
+    {
+        TradeJournal journal;
+        check("reset_create", journal.open(scratch.journal, 1) && appendRecords(journal, 10, 1));
+    }
+    {
+        uint64_t first_seq = 11;
+        std::fstream file(scratch.journal, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(FIRST_SEQ_OFFSET));
+        file.write(reinterpret_cast<const char*>(&first_seq), sizeof(first_seq));
+    }
+
+    TradeJournal journal;
+    check("reset_interrupted", journal.open(scratch.journal, 1) && journal.firstSeq() == 11 &&
+                                   journal.nextSeq() == 11 && readAll(journal) == 0);
+}
+
+// Records past the database's JournalCheckpoint are replayed on startup,
+// each exactly once, and a corrupt tail is not.
+void checkReplay() {
+    Scratch scratch("recovery_replay");
+    check("replay_prepare", prepareDatabase(scratch.db, 1));
+    SymbolId symbol = SymbolTable::global().intern(SYMBOL);
+    const int user_id = 1; // on shard 1 of 2
+    const std::string checkpoint_sql = "SELECT Seq FROM JournalCheckpoint WHERE Journal = '" + scratch.shard(1) + "';";
+
+    {
+        DatabaseManager db(scratch.db);
+        bool ok = db.openJournal(scratch.journal, 2);
+        for (int i = 0; ok && i < 5; ++i) {
+            ok = db.executeTrade(user_id, {symbol, "buy", 2, Money::fromUnits(10)}) == TradeResult::Applied;
+        }
+        check("replay_trades", ok);
+    }
+    check("replay_projected", queryInt(scratch.db, checkpoint_sql) == 5);
+
+    // Trades that reached the journal but not the database, then a torn one.
+    {
+        TradeJournal journal;
+        check("replay_append_tail", journal.open(scratch.shard(1), 1) && appendRecords(journal, 4, user_id));
+    }
+    corrupt(scratch.shard(1), 8, CRC_OFFSET, 4, 0x7F);
+
+    {
+        DatabaseManager db(scratch.db);
+        Portfolio portfolio;
+        bool opened = db.openJournal(scratch.journal, 2);
+        check("replay_open", opened);
+        check("replay_account", opened && db.loadPortfolio(user_id, portfolio) &&
+                                    portfolio.getHeldQuantity(symbol) == 13 &&
+                                    portfolio.getFundBalance() == Money::fromUnits(10000 - 130));
+    }
+    check("replay_checkpoint", queryInt(scratch.db, checkpoint_sql) == 8);
+    check("replay_position", queryInt(scratch.db, "SELECT Quantity FROM Position WHERE UserID = 1;") == 13);
+    check("replay_cash", queryInt(scratch.db, "SELECT CashMicros FROM Portfolio WHERE UserID = 1;") ==
+                             Money::fromUnits(10000 - 130).getMicros());
+
+    // A second start has nothing left to replay.
+    {
+        DatabaseManager db(scratch.db);
+        check("replay_idempotent", db.openJournal(scratch.journal, 2));
+    }
+    check("replay_idempotent_position", queryInt(scratch.db, "SELECT Quantity FROM Position WHERE UserID = 1;") == 13);
+}
+
+// A journal left by a run with more shards is replayed and removed, and its
+// account carries on from another shard's journal.
+void checkRetiredJournal() {
+    Scratch scratch("recovery_retired");
+    check("retired_prepare", prepareDatabase(scratch.db, 3));
+    SymbolId symbol = SymbolTable::global().intern(SYMBOL);
+    const int user_id = 2; // on shard 2 of 3, shard 0 of 2
+
+    {
+        DatabaseManager db(scratch.db);
+        check("retired_trades", db.openJournal(scratch.journal, 3) &&
+                                    db.executeTrade(user_id, {symbol, "buy", 2, Money::fromUnits(10)}) == TradeResult::Applied);
+    }
+    // A trade that reached shard 2's journal but not the database.
+    {
+        TradeJournal journal;
+        check("retired_append_tail", journal.open(scratch.shard(2), 1) && appendRecords(journal, 1, user_id));
+    }
+
+    {
+        DatabaseManager db(scratch.db);
+        Portfolio portfolio;
+        bool opened = db.openJournal(scratch.journal, 2);
+        check("retired_open", opened && !std::filesystem::exists(scratch.shard(2)));
+        check("retired_replayed", opened && db.loadPortfolio(user_id, portfolio) && portfolio.getHeldQuantity(symbol) == 3);
+        check("retired_new_trade", opened && db.executeTrade(user_id, {symbol, "buy", 1, Money::fromUnits(10)}) == TradeResult::Applied);
+    }
+    check("retired_position", queryInt(scratch.db, "SELECT Quantity FROM Position WHERE UserID = 2;") == 4);
+}
+
+// Many threads posting to the same shards' inboxes: every trade is applied
+// exactly once and every caller is answered.
+void checkInbox() {
+    Scratch scratch("recovery_inbox");
+    const int users = 4;
+    const int threads = 8;
+    const int trades_per_thread = 500;
+    check("inbox_prepare", prepareDatabase(scratch.db, users));
+    SymbolId symbol = SymbolTable::global().intern(SYMBOL);
+
+    const int per_user = threads * trades_per_thread / users;
+    {
+        DatabaseManager db(scratch.db);
+        check("inbox_open", db.openJournal(scratch.journal, 3));
+
+        std::atomic<int> applied{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (int i = 0; i < trades_per_thread; ++i) {
+                    int user_id = 1 + (t + i) % users;
+                    if (db.executeTrade(user_id, {symbol, "buy", 1, Money::fromUnits(1)}) == TradeResult::Applied) {
+                        applied.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        check("inbox_all_applied", applied.load() == threads * trades_per_thread);
+
+        bool exact = true;
+        for (int user_id = 1; user_id <= users; ++user_id) {
+            Portfolio portfolio;
+            exact = exact && db.loadPortfolio(user_id, portfolio) && portfolio.getHeldQuantity(symbol) == per_user &&
+                    portfolio.getFundBalance() == Money::fromUnits(10000 - per_user);
+        }
+        check("inbox_accounts", exact);
+    }
+    check("inbox_projected", queryInt(scratch.db, "SELECT SUM(Quantity) FROM Position;") == threads * trades_per_thread);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--dir SCRATCH_DIR]\n", argv[0]);
+            return 2;
+        }
+    }
+    Logger::global().setLevel(LogLevel::Warn);
+
+    // A lost wakeup in an inbox would hang rather than fail.
+    std::thread([]() {
+        std::this_thread::sleep_for(std::chrono::minutes(2));
+        std::printf("FAIL timeout\n");
+        std::fflush(stdout);
+        std::_Exit(1);
+    }).detach();
+
+    checkTornWrite();
+    checkCrc();
+    checkInterruptedReset();
+    checkReplay();
+    checkRetiredJournal();
+    checkInbox();
+
+    std::printf("%s\n", failures == 0 ? "all checks passed" : "some checks failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -1,17 +1,21 @@
 #include "Stock.h"
 
-Stock::Stock(const std::string& sym, int qty, double price)
-    : symbol(sym), quantity(qty), purchase_price(price) {}
+Stock::Stock(SymbolId symbol_id, int qty, Money price)
+    : symbol_id(symbol_id), quantity(qty), purchase_price(price) {}
 
-std::string Stock::getSymbol() const {
-    return symbol;
+const std::string& Stock::getSymbol() const {
+    return SymbolTable::global().name(symbol_id);
+}
+
+SymbolId Stock::getSymbolId() const {
+    return symbol_id;
 }
 
 int Stock::getQuantity() const {
     return quantity;
 }
 
-double Stock::getPurchasePrice() const {
+Money Stock::getPurchasePrice() const {
     return purchase_price;
 }
 
@@ -2,21 +2,24 @@
 #define STOCK_H
 
 #include <string>
+#include "SymbolTable.h"
+#include "Money.h"
 
 class Stock {
 private:
-    std::string symbol;
+    SymbolId symbol_id;
     int quantity;
-    double purchase_price;
+    Money purchase_price;
 
 public:
     // Constructors
-    Stock(const std::string& sym, int qty, double price);
+    Stock(SymbolId symbol_id, int qty, Money price);
 
     // Getters
-    std::string getSymbol() const;
+    const std::string& getSymbol() const; // from SymbolTable::global()
+    SymbolId getSymbolId() const;
     int getQuantity() const;
-    double getPurchasePrice() const;
+    Money getPurchasePrice() const;
 
     // Modifiers
     void addToQuantity(int amount);
@@ -24,4 +27,3 @@ public:
 };
 
 #endif // STOCK_H
-
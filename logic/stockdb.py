@@ -1,6 +1,7 @@
 import yfinance as yf
 import sqlite3
 import sys
+import csv
 from datetime import datetime
 
 # --- List of Stock Symbols to Fetch ---
@@ -11,6 +12,13 @@ STOCK_SYMBOLS = [
 
 DATABASE = "stock_portfolio.db"
 
+# Column order of the quote CSV consumed by the C++ ingester (POST /update_stocks)
+CSV_COLUMNS = [
+    "Symbol", "CompanyName", "Price", "Volume", "Timestamp",
+    "MarketCap", "AvgVolume", "DividendYield", "PERatio",
+    "FiftyTwoWeekLow", "FiftyTwoWeekHigh", "DayLow", "DayHigh", "PreviousClose"
+]
+
 def connect_db():
     """
     Connect to the SQLite database and create Stock + MarketData tables if not exist.
@@ -146,9 +154,42 @@ def update_database(data):
     conn.close()
 
 
+def write_csv(data, path):
+    """
+    Write fetched quotes as a CSV file for the C++ server's native ingester.
+    """
+    timestamp = datetime.utcnow().strftime("%Y-%m-%d %H:%M:%S")
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(CSV_COLUMNS)
+        for symbol, info in data.items():
+            price = info.get("regularMarketPrice") or info.get("previousClose")
+            if not info or price is None:
+                continue
+            writer.writerow([
+                symbol,
+                info.get('shortName') or symbol,
+                price,
+                info.get("volume") or info.get("averageVolume"),
+                timestamp,
+                info.get('marketCap'),
+                info.get('averageVolume'),
+                info.get('dividendYield'),
+                info.get('trailingPE'),
+                info.get('fiftyTwoWeekLow'),
+                info.get('fiftyTwoWeekHigh'),
+                info.get('dayLow'),
+                info.get('dayHigh'),
+                info.get('previousClose')
+            ])
+
+
 if __name__ == "__main__":
     stock_data = fetch_stock_data()
-    if stock_data:
+    if stock_data and len(sys.argv) == 3 and sys.argv[1] == "--csv":
+        write_csv(stock_data, sys.argv[2])
+        print(f"[Python] Wrote latest stock + market data to {sys.argv[2]}.")
+    elif stock_data:
         update_database(stock_data)
         print("[Python] Database updated with latest stock + market data.")
     else:
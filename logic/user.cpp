@@ -3,7 +3,7 @@
 User::User(const std::string& username, int userId) 
     : username(username), userId(userId) {
     // Initialize portfolio with a default balance.
-    portfolio = std::make_unique<Portfolio>(10000.00); 
+    portfolio = std::make_unique<Portfolio>(DEFAULT_FUND_BALANCE); 
 }
 
 std::string User::getUsername() const {